@@ -0,0 +1,788 @@
+#include "countkernel.h"
+#include "logic.h"
+#include "noguess.h"
+#include "player.h"
+#include "probability.h"
+#include "protocol.h"
+#include "replay.h"
+#include "solver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Headless benchmarks for the Board engine, built as minesweeper_bench.
+ * Every benchmark runs on fixed seeds and reports mean, p50 and p99 time per operation.
+ *
+ * Usage: minesweeper_bench [--filter TEXT] [--json FILE] [--compare FILE] [--threshold PERCENT] [--stat mean|p50|p99]
+ *   --filter     only run benchmarks whose name contains TEXT
+ *   --json       write the results as JSON to FILE, e.g. to store a baseline
+ *   --compare    compare against a baseline written by --json, exit with 1 if any benchmark regressed
+ *   --threshold  allowed slowdown in percent before a benchmark counts as regressed, default 10
+ *   --stat       statistic compared against the baseline, default p50
+ */
+
+using Clock = chrono::steady_clock;
+
+/**
+ * Timing samples of one benchmark, in nanoseconds per operation
+ */
+struct Result {
+    string name;
+    vector<double> samples;
+    //Items processed per operation (e.g. revealed cells), 0 if no throughput is reported
+    double items = 0;
+    double mean = 0;
+    double p50 = 0;
+    double p99 = 0;
+};
+
+/**
+ * A named benchmark filling a Result with samples
+ */
+struct Benchmark {
+    string name;
+    function<void(Result &)> run;
+};
+
+/**
+ * @param op operation to time
+ * @return time taken by op in nanoseconds
+ */
+template <typename F>
+double TimeNs(F op) {
+    auto start = Clock::now();
+    op();
+    return chrono::duration<double, nano>(Clock::now() - start).count();
+}
+
+/**
+ * @param sorted samples in ascending order
+ * @param percent percentile between 0 and 100
+ * @return nearest-rank percentile of the samples
+ */
+double Percentile(const vector<double> &sorted, double percent) {
+    size_t rank = (size_t)(percent / 100 * sorted.size() + 0.999999);
+    return sorted[min(max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+/**
+ * Fills mean, p50 and p99 of a result from its samples
+ */
+void Summarise(Result &result) {
+    vector<double> sorted = result.samples;
+    sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double sample : sorted) {
+        sum += sample;
+    }
+    result.mean = sum / sorted.size();
+    result.p50 = Percentile(sorted, 50);
+    result.p99 = Percentile(sorted, 99);
+}
+
+/**
+ * @return flat index of the first safe 0 cell of a board, or -1 if there is none
+ */
+template <typename B>
+int FirstZeroCell(B &board) {
+    const uint8_t *cells = board.GetView().Data();
+    for (int i = 0; i < board.GetHeight() * board.GetWidth(); i++) {
+        if ((cells[i] & (Board::CELL_MINE | Board::CELL_COUNT)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @return preset board, Board takes the level at run time while the fixed boards have it built in
+ */
+template <typename B>
+B MakePreset(Level, uint64_t seed) {
+    return B(seed);
+}
+template <>
+Board MakePreset<Board>(Level level, uint64_t seed) {
+    return Board(level, seed);
+}
+
+/**
+ * Board construction including mine placement and counts, timed in batches
+ * @param batch boards constructed per sample
+ */
+void BenchConstruct(Result &result, int height, int width, int bombs, int samples, int batch) {
+    uint64_t seed = 0;
+    for (int s = 0; s < samples; s++) {
+        double ns = TimeNs([&] {
+            for (int i = 0; i < batch; i++) {
+                Board board(height, width, bombs, seed++);
+            }
+        });
+        result.samples.push_back(ns / batch);
+    }
+}
+
+/**
+ * Preset board construction through MakePreset, timed in batches
+ */
+template <typename B>
+void BenchConstructPreset(Result &result, Level level, int samples, int batch) {
+    uint64_t seed = 0;
+    for (int s = 0; s < samples; s++) {
+        double ns = TimeNs([&] {
+            for (int i = 0; i < batch; i++) {
+                B board = MakePreset<B>(level, seed++);
+            }
+        });
+        result.samples.push_back(ns / batch);
+    }
+}
+
+/**
+ * Construction of boards that defer mine placement to the first Open, timed in batches
+ */
+void BenchConstructDeferred(Result &result, Level level, int samples, int batch) {
+    uint64_t seed = 0;
+    for (int s = 0; s < samples; s++) {
+        double ns = TimeNs([&] {
+            for (int i = 0; i < batch; i++) {
+                Board board(level, seed++, FIRST_CLICK_OPENING);
+            }
+        });
+        result.samples.push_back(ns / batch);
+    }
+}
+
+/**
+ * First Open in the centre of a board with deferred placement, placing the mines and opening the area
+ */
+void BenchFirstOpen(Result &result, Level level, int samples) {
+    for (int s = 0; s < samples; s++) {
+        Board board(level, s, FIRST_CLICK_OPENING);
+        result.samples.push_back(TimeNs([&] {
+            board.Open(board.GetHeight() / 2, board.GetWidth() / 2);
+        }));
+    }
+}
+
+/**
+ * Open on the first 0 cell of a board, flood filling its 0 area
+ */
+void BenchOpenCascade(Result &result, int height, int width, int bombs, int samples) {
+    double revealed = 0;
+    for (int s = 0; s < samples; s++) {
+        Board board(height, width, bombs, s);
+        int start = FirstZeroCell(board);
+        result.samples.push_back(TimeNs([&] {
+            board.Open(start / width, start % width);
+        }));
+        revealed += board.GetChanges().size();
+    }
+    result.items = revealed / samples;
+}
+
+/**
+ * Undo of an Open on the first 0 cell of a board, reverting its 0 area from the journal
+ */
+void BenchUndoCascade(Result &result, int height, int width, int bombs, int samples) {
+    double reverted = 0;
+    for (int s = 0; s < samples; s++) {
+        Board board(height, width, bombs, s);
+        board.EnableJournal();
+        int start = FirstZeroCell(board);
+        board.Open(start / width, start % width);
+        result.samples.push_back(TimeNs([&] {
+            board.Undo();
+        }));
+        reverted += board.GetChanges().size();
+    }
+    result.items = reverted / samples;
+}
+
+/**
+ * Save or Load of a board with its first 0 area opened and a flag on every fourth mine
+ * @param load true to time Load of the saved game, false to time Save
+ */
+void BenchSaveLoad(Result &result, int height, int width, int bombs, bool load, int samples) {
+    const string path = "minesweeper_bench.sav";
+    Board board(height, width, bombs, 1);
+    int start = FirstZeroCell(board);
+    board.Open(start / width, start % width);
+    const uint8_t *cells = board.GetView().Data();
+    for (int i = 0, mines = 0; i < height * width; i++) {
+        if ((cells[i] & Board::CELL_MINE) && mines++ % 4 == 0) {
+            board.Flag(i / width, i % width);
+        }
+    }
+    board.Save(path, 0);
+    Board loaded(EASY, 0);
+    uint32_t elapsed;
+    for (int s = 0; s < samples; s++) {
+        result.samples.push_back(TimeNs([&] {
+            if (load) {
+                loaded.Load(path, elapsed);
+            } else {
+                board.Save(path, 0);
+            }
+        }));
+    }
+    remove(path.c_str());
+    result.items = (double)height * width;
+}
+
+/**
+ * @return replay of a long game on a large board: random safe cells are opened and every fourth
+ * move flags a random mine, until the replay holds the given number of moves
+ */
+Replay LongReplay(int height, int width, int bombs, int moves) {
+    Replay replay;
+    replay.height = height;
+    replay.width = width;
+    replay.mines = bombs;
+    replay.seed = 1;
+    Board board(height, width, bombs, replay.seed);
+    const uint8_t *cells = board.GetView().Data();
+    vector<int> safe;
+    vector<int> mines;
+    for (int i = 0; i < height * width; i++) {
+        (cells[i] & Board::CELL_MINE ? mines : safe).push_back(i);
+    }
+    Xoshiro256 gen{2};
+    shuffle(safe.begin(), safe.end(), gen);
+    size_t next = 0;
+    for (int move = 0; move < moves; move++) {
+        int index;
+        if (move % 4 == 3) {
+            index = mines[gen() % mines.size()];
+            board.Flag(index / width, index % width);
+        } else {
+            while (cells[safe[next]] & Board::CELL_OPEN) {
+                next++;
+            }
+            index = safe[next];
+            board.Open(index / width, index % width);
+        }
+        replay.moves.push_back({(uint32_t)move * 250, move % 4 == 3 ? REPLAY_FLAG : REPLAY_OPEN, index});
+    }
+    replay.result = board.GetState();
+    replay.duration = replay.moves.back().time;
+    return replay;
+}
+
+/**
+ * Seek to random moves of a 100k move replay on a 1024x1024 board
+ * @param interval moves between keyframes, 0 for none so every seek plays from the start
+ */
+void BenchSeek(Result &result, int interval, int samples) {
+    static const Replay replay = LongReplay(1024, 1024, 104857, 100000);
+    vector<uint8_t> data;
+    EncodeReplay(replay, data, interval);
+    ReplaySeeker seeker;
+    seeker.Open(data.data(), data.size());
+    Board board(EASY, 0);
+    Xoshiro256 gen{3};
+    for (int s = 0; s < samples; s++) {
+        int target = gen() % (replay.moves.size() + 1);
+        result.samples.push_back(TimeNs([&] {
+            seeker.Seek(board, target);
+        }));
+    }
+}
+
+/**
+ * Open on an opened numbered cell whose mines are all flagged, chording its neighbours
+ */
+void BenchChord(Result &result, int samples) {
+    for (uint64_t seed = 0; (int)result.samples.size() < samples; seed++) {
+        Board board(HARD, seed);
+        int width = board.GetWidth();
+        int start = FirstZeroCell(board);
+        if (start < 0) {
+            continue;
+        }
+        board.Open(start / width, start % width);
+        GridView view = board.GetView();
+        NeighbourTable neighbours{board.GetHeight(), width};
+        vector<int> opened = board.GetChanges();
+        //First opened numbered cell with an unopened neighbour
+        for (int index : opened) {
+            int unopened = 0;
+            neighbours.ForEach(index, [&](int n) {
+                unopened += view.At(n) == 10;
+            });
+            if (view.At(index) == 0 || unopened == 0) {
+                continue;
+            }
+            neighbours.ForEach(index, [&](int n) {
+                if (view.Data()[n] & Board::CELL_MINE) {
+                    board.Flag(n / width, n % width);
+                }
+            });
+            result.samples.push_back(TimeNs([&] {
+                board.Open(index / width, index % width);
+            }));
+            break;
+        }
+    }
+}
+
+/**
+ * Flag toggling the same cell, timed in batches
+ * @param batch toggles per sample
+ */
+void BenchFlag(Result &result, int samples, int batch) {
+    Board board(HARD, 1);
+    for (int s = 0; s < samples; s++) {
+        double ns = TimeNs([&] {
+            for (int i = 0; i < batch; i++) {
+                board.Flag(5, 7);
+            }
+        });
+        result.samples.push_back(ns / batch);
+    }
+}
+
+/**
+ * A whole game opening every safe cell in row-major order until the win is detected
+ */
+void BenchWin(Result &result, int samples) {
+    for (int s = 0; s < samples; s++) {
+        Board board(HARD, s);
+        const uint8_t *cells = board.GetView().Data();
+        int width = board.GetWidth();
+        result.samples.push_back(TimeNs([&] {
+            for (int i = 0; i < board.GetHeight() * width; i++) {
+                if ((cells[i] & (Board::CELL_MINE | Board::CELL_OPEN)) == 0 && board.Open(i / width, i % width) == WON) {
+                    break;
+                }
+            }
+        }));
+    }
+}
+
+/**
+ * operator<< of a partly opened board to an in-memory stream
+ */
+void BenchPrint(Result &result, int samples) {
+    Board board(HARD, 1);
+    int start = FirstZeroCell(board);
+    board.Open(start / board.GetWidth(), start % board.GetWidth());
+    for (int s = 0; s < samples; s++) {
+        ostringstream out;
+        result.samples.push_back(TimeNs([&] {
+            out << board;
+        }));
+    }
+}
+
+/**
+ * Protocol command and reply for open, as sent by a bot: every safe cell of a game is opened
+ * in row-major order, one sample per command
+ */
+void BenchProtocol(Result &result, int games) {
+    ProtocolEngine engine;
+    ostringstream out;
+    for (int game = 0; game < games; game++) {
+        engine.Execute("new hard " + to_string(game), out);
+        Board answer(HARD, game);
+        const uint8_t *cells = answer.GetView().Data();
+        for (int i = 0; i < 16 * 30; i++) {
+            if (!(cells[i] & Board::CELL_MINE)) {
+                string command = "open " + to_string(i / 30) + " " + to_string(i % 30);
+                out.str("");
+                result.samples.push_back(TimeNs([&] {
+                    engine.Execute(command, out);
+                }));
+            }
+        }
+    }
+}
+
+/**
+ * Solver time per game, playing every safe deduction from the first 0 cell until the game is won
+ * or needs a guess. A position is one Solve call, items are positions per game.
+ */
+template <typename B>
+void BenchSolver(Result &result, Level level, int samples) {
+    double positions = 0;
+    for (int s = 0; s < samples; s++) {
+        B board = MakePreset<B>(level, s);
+        GridView view = board.GetView();
+        int width = board.GetWidth();
+        int start = FirstZeroCell(board);
+        GameState state = board.Open(start / width, start % width);
+        double ns = 0;
+        Solver *solver = nullptr;
+        ns += TimeNs([&] {
+            solver = new Solver(view);
+        });
+        size_t next = 0;
+        while (state == PLAYING) {
+            ns += TimeNs([&] {
+                solver->Solve();
+            });
+            positions += 1;
+            const vector<int> &safe = solver->GetSafe();
+            if (next == safe.size()) {
+                break;
+            }
+            for (; next < safe.size() && state == PLAYING; next++) {
+                if (view.At(safe[next]) == 10) {
+                    state = board.Open(safe[next] / width, safe[next] % width);
+                    ns += TimeNs([&] {
+                        solver->Update(board.GetChanges());
+                    });
+                }
+            }
+        }
+        delete solver;
+        result.samples.push_back(ns);
+    }
+    result.items = positions / samples;
+}
+
+/**
+ * Whole games played by Player, as in minesweeper_sim, one sample per game
+ */
+template <typename B>
+void BenchPlay(Result &result, Level level, int samples) {
+    Player player;
+    for (int s = 0; s < samples; s++) {
+        B board = MakePreset<B>(level, s);
+        result.samples.push_back(TimeNs([&] {
+            player.Play(board);
+        }));
+    }
+}
+
+/**
+ * Probability latency over a corpus of positions needing a guess. Each game plays the solver's
+ * safe cells from the first 0 cell; whenever it is stuck the probabilities are computed (one
+ * sample) and the safest cell is opened, until the game ends.
+ */
+void BenchProbability(Result &result, Level level, int games) {
+    ProbabilityEngine engine;
+    for (int s = 0; s < games; s++) {
+        Board board(level, s);
+        GridView view = board.GetView();
+        int width = board.GetWidth();
+        int start = FirstZeroCell(board);
+        GameState state = board.Open(start / width, start % width);
+        Solver solver{view};
+        size_t next = 0;
+        while (state == PLAYING) {
+            solver.Solve();
+            const vector<int> &safe = solver.GetSafe();
+            if (next < safe.size()) {
+                for (; next < safe.size() && state == PLAYING; next++) {
+                    if (view.At(safe[next]) == 10) {
+                        state = board.Open(safe[next] / width, safe[next] % width);
+                        solver.Update(board.GetChanges());
+                    }
+                }
+                continue;
+            }
+            result.samples.push_back(TimeNs([&] {
+                engine.Compute(view, board.GetFlagsLeft());
+            }));
+            const vector<double> &probabilities = engine.GetProbabilities();
+            int guess = -1;
+            for (int i = 0; i < board.GetHeight() * width; i++) {
+                if (view.At(i) == 10 && (guess < 0 || probabilities[i] < probabilities[guess])) {
+                    guess = i;
+                }
+            }
+            state = board.Open(guess / width, guess % width);
+            solver.Update(board.GetChanges());
+        }
+    }
+}
+
+/**
+ * No-guess board generation with the first click in the centre, on all cores
+ */
+void BenchNoGuess(Result &result, Level level, int samples) {
+    static NoGuessGenerator generator;
+    Board preset(level, 0);
+    int height = preset.GetHeight();
+    int width = preset.GetWidth();
+    for (int s = 0; s < samples; s++) {
+        result.samples.push_back(TimeNs([&] {
+            generator.Generate(height, width, preset.GetFlagsLeft(), height / 2, width / 2, s, 10000);
+        }));
+    }
+    //Report boards per second in the throughput column
+    result.items = 1;
+}
+
+/**
+ * Neighbour lookup as done before NeighbourTable, allocating a vector per call
+ */
+vector<array<int, 2>> LegacyNeighbours(int row, int col, int height, int width) {
+    vector<array<int, 2>> neighbours_coords;
+    for (int i = max(row - 1, 0); i <= min(row + 1, height - 1); i++) {
+        for (int j = max(col - 1, 0); j <= min(col + 1, width - 1); j++) {
+            if (i != row || j != col) {
+                neighbours_coords.push_back({i, j});
+            }
+        }
+    }
+    return neighbours_coords;
+}
+
+/**
+ * Neighbour visits over every cell of a grid, timed per visit
+ * @param legacy true to use LegacyNeighbours instead of NeighbourTable
+ */
+void BenchNeighbours(Result &result, int height, int width, bool legacy, int samples) {
+    NeighbourTable table{height, width};
+    long long checksum = 0;
+    for (int s = 0; s < samples; s++) {
+        long long visits = 0;
+        double ns = TimeNs([&] {
+            for (int index = 0; index < height * width; index++) {
+                if (legacy) {
+                    for (auto n : LegacyNeighbours(index / width, index % width, height, width)) {
+                        checksum += n[0] * width + n[1];
+                        visits += 1;
+                    }
+                } else {
+                    table.ForEach(index, [&](int n) {
+                        checksum += n;
+                        visits += 1;
+                    });
+                }
+            }
+        });
+        result.samples.push_back(ns / visits);
+    }
+    //Keep the loops from being optimised away
+    if (checksum == 1) {
+        printf("checksum %lld\n", checksum);
+    }
+}
+
+/**
+ * Neighbour count kernel on a random mine bit matrix with 10% mines
+ */
+void BenchCountKernel(Result &result, CountKernel kernel, int height, int width, int samples) {
+    int words = (width + 63) / 64;
+    vector<uint64_t> mines((size_t)height * words, 0);
+    Xoshiro256 gen{1};
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            if (gen() % 10 == 0) {
+                mines[(size_t)row * words + col / 64] |= 1ULL << (col % 64);
+            }
+        }
+    }
+    vector<uint8_t> cells((size_t)height * width);
+    for (int s = 0; s < samples; s++) {
+        result.samples.push_back(TimeNs([&] {
+            CountNeighbourMines(mines.data(), height, width, Board::CELL_MINE, cells.data(), kernel);
+        }));
+    }
+    result.items = (double)height * width;
+}
+
+/**
+ * @return every benchmark of the suite, in run order
+ */
+vector<Benchmark> AllBenchmarks() {
+    vector<Benchmark> all = {
+        {"construct/EASY", [](Result &r) { BenchConstruct(r, 9, 9, 10, 30, 2000); }},
+        {"construct/NORMAL", [](Result &r) { BenchConstruct(r, 16, 16, 40, 30, 1000); }},
+        {"construct/HARD", [](Result &r) { BenchConstruct(r, 16, 30, 99, 30, 1000); }},
+        {"construct/HARD_fixed", [](Result &r) { BenchConstructPreset<HardBoard>(r, HARD, 30, 1000); }},
+        {"construct/1000x1000", [](Result &r) { BenchConstruct(r, 1000, 1000, 100000, 10, 1); }},
+        {"construct/HARD_deferred", [](Result &r) { BenchConstructDeferred(r, HARD, 30, 1000); }},
+        {"first_open/HARD_opening", [](Result &r) { BenchFirstOpen(r, HARD, 1000); }},
+        {"open_cascade/16x30_1%", [](Result &r) { BenchOpenCascade(r, 16, 30, 4, 500); }},
+        {"open_cascade/1024x1024_1%", [](Result &r) { BenchOpenCascade(r, 1024, 1024, 10485, 10); }},
+        {"open_cascade/4096x4096_1%", [](Result &r) { BenchOpenCascade(r, 4096, 4096, 167772, 3); }},
+        {"undo_cascade/1024x1024_1%", [](Result &r) { BenchUndoCascade(r, 1024, 1024, 10485, 10); }},
+        {"save/4096x4096", [](Result &r) { BenchSaveLoad(r, 4096, 4096, 167772, false, 5); }},
+        {"load/4096x4096", [](Result &r) { BenchSaveLoad(r, 4096, 4096, 167772, true, 5); }},
+        {"seek/100k_moves_scan", [](Result &r) { BenchSeek(r, 0, 10); }},
+        {"seek/100k_moves_keyframes_1000", [](Result &r) { BenchSeek(r, 1000, 100); }},
+        {"seek/100k_moves_keyframes_5000", [](Result &r) { BenchSeek(r, 5000, 100); }},
+        {"chord/HARD", [](Result &r) { BenchChord(r, 300); }},
+        {"flag/HARD", [](Result &r) { BenchFlag(r, 30, 10000); }},
+        {"win/HARD", [](Result &r) { BenchWin(r, 200); }},
+        {"print/HARD", [](Result &r) { BenchPrint(r, 300); }},
+        {"protocol/HARD_open", [](Result &r) { BenchProtocol(r, 50); }},
+        {"solver/EASY", [](Result &r) { BenchSolver<Board>(r, EASY, 1000); }},
+        {"solver/NORMAL", [](Result &r) { BenchSolver<Board>(r, NORMAL, 1000); }},
+        {"solver/HARD", [](Result &r) { BenchSolver<Board>(r, HARD, 1000); }},
+        {"solver/EASY_fixed", [](Result &r) { BenchSolver<EasyBoard>(r, EASY, 1000); }},
+        {"solver/NORMAL_fixed", [](Result &r) { BenchSolver<NormalBoard>(r, NORMAL, 1000); }},
+        {"solver/HARD_fixed", [](Result &r) { BenchSolver<HardBoard>(r, HARD, 1000); }},
+        {"play/EASY", [](Result &r) { BenchPlay<Board>(r, EASY, 1000); }},
+        {"play/NORMAL", [](Result &r) { BenchPlay<Board>(r, NORMAL, 500); }},
+        {"play/HARD", [](Result &r) { BenchPlay<Board>(r, HARD, 300); }},
+        {"play/EASY_fixed", [](Result &r) { BenchPlay<EasyBoard>(r, EASY, 1000); }},
+        {"play/NORMAL_fixed", [](Result &r) { BenchPlay<NormalBoard>(r, NORMAL, 500); }},
+        {"play/HARD_fixed", [](Result &r) { BenchPlay<HardBoard>(r, HARD, 300); }},
+        {"probability/EASY", [](Result &r) { BenchProbability(r, EASY, 300); }},
+        {"probability/NORMAL", [](Result &r) { BenchProbability(r, NORMAL, 300); }},
+        {"probability/HARD", [](Result &r) { BenchProbability(r, HARD, 300); }},
+        {"no_guess/EASY", [](Result &r) { BenchNoGuess(r, EASY, 300); }},
+        {"no_guess/NORMAL", [](Result &r) { BenchNoGuess(r, NORMAL, 100); }},
+        {"no_guess/HARD", [](Result &r) { BenchNoGuess(r, HARD, 30); }},
+        {"neighbours/legacy_1024x1024", [](Result &r) { BenchNeighbours(r, 1024, 1024, true, 3); }},
+        {"neighbours/table_1024x1024", [](Result &r) { BenchNeighbours(r, 1024, 1024, false, 3); }},
+    };
+    const char *kernel_names[] = {"scalar", "sse2", "avx2"};
+    for (int kernel = KERNEL_SCALAR; kernel <= SelectCountKernel(); kernel++) {
+        all.push_back({string("count_kernel/") + kernel_names[kernel] + "_2048x2048", [kernel](Result &r) {
+                           BenchCountKernel(r, (CountKernel)kernel, 2048, 2048, 10);
+                       }});
+    }
+    return all;
+}
+
+/**
+ * @return a duration in ns formatted with a readable unit
+ */
+string FormatNs(double ns) {
+    char text[32];
+    if (ns >= 1e6) {
+        snprintf(text, sizeof(text), "%.3f ms", ns / 1e6);
+    } else if (ns >= 1e3) {
+        snprintf(text, sizeof(text), "%.3f us", ns / 1e3);
+    } else {
+        snprintf(text, sizeof(text), "%.1f ns", ns);
+    }
+    return text;
+}
+
+/**
+ * Writes results as JSON, one object per benchmark, times in ns
+ */
+void WriteJson(const string &path, const vector<Result> &results) {
+    ofstream out(path);
+    out << "{\n  \"unit\": \"ns\",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"samples\": " << r.samples.size()
+            << ", \"mean\": " << r.mean << ", \"p50\": " << r.p50 << ", \"p99\": " << r.p99
+            << ", \"items\": " << r.items << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+/**
+ * Reads one statistic per benchmark from a file written by WriteJson
+ * @param path JSON file
+ * @param stat key of the statistic, mean, p50 or p99
+ * @return benchmark name to value, empty if the file cannot be read
+ */
+map<string, double> ReadBaseline(const string &path, const string &stat) {
+    map<string, double> baseline;
+    ifstream in(path);
+    stringstream buffer;
+    buffer << in.rdbuf();
+    string text = buffer.str();
+    const string name_key = "\"name\": \"";
+    const string stat_key = "\"" + stat + "\": ";
+    for (size_t pos = text.find(name_key); pos != string::npos; pos = text.find(name_key, pos)) {
+        pos += name_key.size();
+        size_t name_end = text.find('"', pos);
+        size_t object_end = text.find('}', pos);
+        size_t stat_pos = text.find(stat_key, pos);
+        if (name_end == string::npos || stat_pos == string::npos || stat_pos > object_end) {
+            continue;
+        }
+        baseline[text.substr(pos, name_end - pos)] = strtod(text.c_str() + stat_pos + stat_key.size(), NULL);
+    }
+    return baseline;
+}
+
+int main(int argc, char *argv[]) {
+    string filter;
+    string json_path;
+    string compare_path;
+    string stat = "p50";
+    double threshold = 10;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 < argc && arg == "--filter") {
+            filter = argv[++i];
+        } else if (i + 1 < argc && arg == "--json") {
+            json_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--compare") {
+            compare_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--threshold") {
+            threshold = atof(argv[++i]);
+        } else if (i + 1 < argc && arg == "--stat") {
+            stat = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--filter TEXT] [--json FILE] [--compare FILE] [--threshold PERCENT] [--stat mean|p50|p99]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (stat != "mean" && stat != "p50" && stat != "p99") {
+        fprintf(stderr, "Unknown statistic %s, expected mean, p50 or p99\n", stat.c_str());
+        return 2;
+    }
+
+    vector<Result> results;
+    printf("%-30s %8s %12s %12s %12s %12s\n", "benchmark", "samples", "mean", "p50", "p99", "items/s");
+    for (Benchmark &benchmark : AllBenchmarks()) {
+        if (benchmark.name.find(filter) == string::npos) {
+            continue;
+        }
+        Result result;
+        result.name = benchmark.name;
+        benchmark.run(result);
+        Summarise(result);
+        printf("%-30s %8zu %12s %12s %12s", result.name.c_str(), result.samples.size(), FormatNs(result.mean).c_str(),
+               FormatNs(result.p50).c_str(), FormatNs(result.p99).c_str());
+        if (result.items > 0) {
+            printf(" %12.0f", result.items / result.mean * 1e9);
+        }
+        printf("\n");
+        fflush(stdout);
+        results.push_back(result);
+    }
+
+    if (!json_path.empty()) {
+        WriteJson(json_path, results);
+    }
+    if (compare_path.empty()) {
+        return 0;
+    }
+    map<string, double> baseline = ReadBaseline(compare_path, stat);
+    if (baseline.empty()) {
+        fprintf(stderr, "Cannot read baseline %s\n", compare_path.c_str());
+        return 2;
+    }
+    int regressions = 0;
+    printf("\n%s against %s, threshold %.1f%%\n", stat.c_str(), compare_path.c_str(), threshold);
+    for (Result &result : results) {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end()) {
+            printf("%-30s %10s\n", result.name.c_str(), "new");
+            continue;
+        }
+        double current = stat == "mean" ? result.mean : stat == "p50" ? result.p50 : result.p99;
+        double change = (current / it->second - 1) * 100;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        printf("%-30s %+9.1f%% %s\n", result.name.c_str(), change, regressed ? "REGRESSED" : "ok");
+    }
+    if (regressions) {
+        printf("%d benchmark(s) regressed\n", regressions);
+        return 1;
+    }
+    return 0;
+}
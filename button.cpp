@@ -1,10 +1,10 @@
 #ifndef BUTTON_CPP
 #define BUTTON_CPP
 
-#include "texture.cpp"
+#include "text.cpp"
 class Button {
 public:
-    Button(TTF_Font *, SDL_Renderer *, const std::string &, int, int);
+    Button(GlyphAtlas *, SDL_Renderer *, const std::string &, int, int);
 
     /**
      * Different states to consider for rendering texture
@@ -15,42 +15,47 @@ public:
         MOUSE_TOTAL
     };
 
-    bool SetTexture(ButtonState, const SDL_Color *, const SDL_Color *bg = NULL);
+    void SetColor(ButtonState, const SDL_Color &);
     void Render(SDL_Renderer *);
     void Free();
     bool HandleEvent(SDL_Event *);
 
 private:
-    TTF_Font *g_font;
+    GlyphAtlas *g_text;
     SDL_Renderer *g_renderer;
 
-    Texture button_texture[MOUSE_TOTAL];
+    SDL_Color button_color[MOUSE_TOTAL];
     const std::string button_text;
     const int x_pos;
     const int y_pos;
+    const int width;
+    const int height;
 
     ButtonState curr_state = MOUSE_OUT;
     bool left_mouse_down = false;
 };
 
 /**
- * Creates new button and specifies its location on the screen
- * @param font font for text
+ * Creates new button, black in all states, and specifies its location on the screen
+ * @param text_renderer renderer for text
  * @param renderer used for rendering text
  * @param text text to be displayed
  * @param x x position
  * @param y y position
  */
-Button::Button(TTF_Font *font, SDL_Renderer *renderer, const std::string &text, int x, int y) : g_font{font}, g_renderer{renderer}, button_text{text}, x_pos{x}, y_pos{y} {}
+Button::Button(GlyphAtlas *text_renderer, SDL_Renderer *renderer, const std::string &text, int x, int y) : g_text{text_renderer}, g_renderer{renderer}, button_color{}, button_text{text}, x_pos{x}, y_pos{y}, width{text_renderer->GetWidth(text)}, height{text_renderer->GetHeight()} {
+    for (int i = 0; i < MOUSE_TOTAL; i++) {
+        button_color[i] = SDL_Color{0, 0, 0, 255};
+    }
+}
 
 /**
- * Set texture for a button state
- * @param state state to set texture
+ * Set text color for a button state
+ * @param state state to set color
  * @param text_color color of text
- * @param bg_color color of background. If NULL or empty, text is rendered solid, else shaded.
  */
-bool Button::SetTexture(ButtonState state, const SDL_Color *text_color, const SDL_Color *bg_color) {
-    return button_texture[state].LoadFromRenderedText(g_font, g_renderer, button_text, text_color, bg_color);
+void Button::SetColor(ButtonState state, const SDL_Color &text_color) {
+    button_color[state] = text_color;
 }
 
 /**
@@ -61,12 +66,12 @@ void Button::Render(SDL_Renderer *g_renderer) {
     int x, y;
     SDL_GetMouseState(&x, &y);
     //Check if outside button
-    if (x < x_pos || y < y_pos || x > x_pos + button_texture[curr_state].GetWidth() || y > y_pos + button_texture[curr_state].GetHeight()) {
+    if (x < x_pos || y < y_pos || x > x_pos + width || y > y_pos + height) {
         curr_state = MOUSE_OUT;
     } else {
         curr_state = MOUSE_IN;
     }
-    button_texture[curr_state].Render(g_renderer, x_pos, y_pos);
+    g_text->Render(g_renderer, button_text, x_pos, y_pos, button_color[curr_state]);
 }
 
 /**
@@ -74,10 +79,11 @@ void Button::Render(SDL_Renderer *g_renderer) {
  */
 bool Button::HandleEvent(SDL_Event *e) {
     if ((e->type == SDL_MOUSEBUTTONDOWN || e->type == SDL_MOUSEBUTTONUP) && e->button.button == SDL_BUTTON_LEFT) {
-        int x, y;
-        SDL_GetMouseState(&x, &y);
+        //Position of the click, not the current mouse position, as queued events may be handled late
+        int x = e->button.x;
+        int y = e->button.y;
         //Check if within button
-        if (!(x < x_pos || y < y_pos || x > x_pos + button_texture[curr_state].GetWidth() || y > y_pos + button_texture[curr_state].GetHeight())) {
+        if (!(x < x_pos || y < y_pos || x > x_pos + width || y > y_pos + height)) {
             if (e->type == SDL_MOUSEBUTTONDOWN)
                 left_mouse_down = true;
             else if (e->type == SDL_MOUSEBUTTONUP && left_mouse_down) {
@@ -90,12 +96,10 @@ bool Button::HandleEvent(SDL_Event *e) {
 }
 
 /**
- * Frees memory
+ * Frees memory. Text is drawn from the shared atlas, so there is nothing to free.
  */
 void Button::Free() {
-    for (auto x : button_texture) {
-        x.Free();
-    }
+    g_text = NULL;
 }
 
 #endif
\ No newline at end of file
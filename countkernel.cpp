@@ -0,0 +1,244 @@
+#include "countkernel.h"
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define COUNT_KERNEL_X86
+#define KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define KERNEL_INLINE inline
+#endif
+
+/**
+ * @return fastest kernel supported by the running CPU
+ */
+CountKernel SelectCountKernel() {
+#ifdef COUNT_KERNEL_X86
+    static const CountKernel kernel = __builtin_cpu_supports("avx2")   ? KERNEL_AVX2
+                                      : __builtin_cpu_supports("sse2") ? KERNEL_SSE2
+                                                                       : KERNEL_SCALAR;
+    return kernel;
+#else
+    return KERNEL_SCALAR;
+#endif
+}
+
+/**
+ * Adds eight 1-bit inputs per bit lane into a 4-bit sum (b3 b2 b1 b0) with full adders.
+ * Works on any type with bitwise operators, one lane per bit.
+ */
+template <typename V>
+KERNEL_INLINE void SumEight(const V in[8], V &b0, V &b1, V &b2, V &b3) {
+    //Three groups of weight 1
+    V s1 = in[0] ^ in[1] ^ in[2];
+    V c1 = (in[0] & in[1]) | (in[2] & (in[0] ^ in[1]));
+    V s2 = in[3] ^ in[4] ^ in[5];
+    V c2 = (in[3] & in[4]) | (in[5] & (in[3] ^ in[4]));
+    V s3 = in[6] ^ in[7];
+    V c3 = in[6] & in[7];
+    //Combine weight 1 into bit 0, carry c4 has weight 2
+    b0 = s1 ^ s2 ^ s3;
+    V c4 = (s1 & s2) | (s3 & (s1 ^ s2));
+    //Four carries of weight 2
+    V t = c1 ^ c2 ^ c3;
+    V c5 = (c1 & c2) | (c3 & (c1 ^ c2));
+    b1 = t ^ c4;
+    V c6 = t & c4;
+    //Two carries of weight 4
+    b2 = c5 ^ c6;
+    b3 = c5 & c6;
+}
+
+/**
+ * Sums the eight shifted neighbour rows word by word into four count bit planes
+ * @param in eight rows of words, one per neighbour direction
+ * @param out four rows of words receiving count bits 0-3
+ * @param begin first word to process
+ * @param words number of words per row
+ */
+static void AddRowsScalar(const uint64_t *const in[8], uint64_t *const out[4], int begin, int words) {
+    for (int k = begin; k < words; k++) {
+        uint64_t v[8];
+        for (int i = 0; i < 8; i++) {
+            v[i] = in[i][k];
+        }
+        SumEight(v, out[0][k], out[1][k], out[2][k], out[3][k]);
+    }
+}
+
+/**
+ * @return 8 bytes holding bit i of byte in the low bit of byte i
+ */
+static constexpr uint64_t SpreadByte(int byte) {
+    uint64_t spread = 0;
+    for (int i = 0; i < 8; i++) {
+        spread |= (uint64_t)((byte >> i) & 1) << (8 * i);
+    }
+    return spread;
+}
+
+template <size_t... I>
+static constexpr std::array<uint64_t, 256> SpreadTable(std::index_sequence<I...>) {
+    return {SpreadByte(I)...};
+}
+
+//Built at compile time, so it is ready for any caller regardless of initialisation order
+const std::array<uint64_t, 256> SPREAD_BYTES = SpreadTable(std::make_index_sequence<256>{});
+
+/**
+ * Spreads bit planes to one byte per cell, eight cells at a time
+ * @param planes count bits 0-3 and the mine bits of a row
+ * @param weights value each plane adds to the byte of a cell with its bit set
+ * @param begin first column, a multiple of 8
+ * @param width the width of grid
+ * @param out output bytes of the row
+ */
+static void SpreadRowScalar(const uint64_t *const planes[5], const uint8_t weights[5], int begin, int width, uint8_t *out) {
+    const uint64_t *spread = SPREAD_BYTES.data();
+    for (int col = begin; col < width; col += 8) {
+        int k = col >> 6;
+        int shift = col & 63;
+        uint64_t bytes = 0;
+        for (int i = 0; i < 5; i++) {
+            bytes |= spread[(planes[i][k] >> shift) & 0xff] * weights[i];
+        }
+        int n = width - col < 8 ? width - col : 8;
+        for (int i = 0; i < n; i++) {
+            out[col + i] = (uint8_t)(bytes >> (8 * i));
+        }
+    }
+}
+
+#ifdef COUNT_KERNEL_X86
+__attribute__((target("sse2"))) static void AddRowsSse2(const uint64_t *const in[8], uint64_t *const out[4], int words) {
+    int k = 0;
+    for (; k + 2 <= words; k += 2) {
+        __m128i v[8], b[4];
+        for (int i = 0; i < 8; i++) {
+            v[i] = _mm_loadu_si128((const __m128i *)(in[i] + k));
+        }
+        SumEight(v, b[0], b[1], b[2], b[3]);
+        for (int i = 0; i < 4; i++) {
+            _mm_storeu_si128((__m128i *)(out[i] + k), b[i]);
+        }
+    }
+    AddRowsScalar(in, out, k, words);
+}
+
+__attribute__((target("avx2"))) static void AddRowsAvx2(const uint64_t *const in[8], uint64_t *const out[4], int words) {
+    int k = 0;
+    for (; k + 4 <= words; k += 4) {
+        __m256i v[8], b[4];
+        for (int i = 0; i < 8; i++) {
+            v[i] = _mm256_loadu_si256((const __m256i *)(in[i] + k));
+        }
+        SumEight(v, b[0], b[1], b[2], b[3]);
+        for (int i = 0; i < 4; i++) {
+            _mm256_storeu_si256((__m256i *)(out[i] + k), b[i]);
+        }
+    }
+    AddRowsScalar(in, out, k, words);
+}
+
+/**
+ * AVX2 version of SpreadRowScalar, 32 cells at a time: each 32-bit chunk of a plane is
+ * broadcast, its bytes shuffled out to the cell lanes and compared against the bit of each lane.
+ */
+__attribute__((target("avx2"))) static void SpreadRowAvx2(const uint64_t *const planes[5], const uint8_t weights[5], int width, uint8_t *out) {
+    const __m256i select = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i lane_bit = _mm256_set1_epi64x(0x8040201008040201LL);
+    int col = 0;
+    for (; col + 32 <= width; col += 32) {
+        __m256i bytes = _mm256_setzero_si256();
+        for (int i = 0; i < 5; i++) {
+            uint32_t chunk = (uint32_t)(planes[i][col >> 6] >> (col & 63));
+            __m256i spread = _mm256_shuffle_epi8(_mm256_set1_epi32((int)chunk), select);
+            __m256i is_set = _mm256_cmpeq_epi8(_mm256_and_si256(spread, lane_bit), lane_bit);
+            bytes = _mm256_or_si256(bytes, _mm256_and_si256(is_set, _mm256_set1_epi8((char)weights[i])));
+        }
+        _mm256_storeu_si256((__m256i *)(out + col), bytes);
+    }
+    SpreadRowScalar(planes, weights, col, width, out);
+}
+#endif
+
+/**
+ * Computes the neighbour mine count of every cell at once from a packed mine bit matrix.
+ * Each row is shifted left and right, and the eight neighbour rows are summed with bit-sliced
+ * adders (a word-parallel 3x3 convolution), then the count planes are spread to bytes.
+ * @param mines row-major bit matrix, (width + 63) / 64 words per row, bit j of a row is column j
+ * and bits past width are zero
+ * @param height the height of grid
+ * @param width the width of grid
+ * @param mine_bit bit set in the output byte of a mine cell
+ * @param cells row-major output, one byte per cell holding the count in its low nibble
+ * @param kernel implementation of the adders, see SelectCountKernel
+ */
+void CountNeighbourMines(const uint64_t *mines, int height, int width, uint8_t mine_bit, uint8_t *cells, CountKernel kernel) {
+    int words = (width + 63) / 64;
+    //Row r of the grid uses shifted copies of rows r-1, r, r+1 kept in a ring of three
+    std::vector<uint64_t> scratch(words * 11, 0);
+    uint64_t *zero = &scratch[0];
+    uint64_t *left[3] = {&scratch[words], &scratch[2 * words], &scratch[3 * words]};
+    uint64_t *right[3] = {&scratch[4 * words], &scratch[5 * words], &scratch[6 * words]};
+    uint64_t *const count[4] = {&scratch[7 * words], &scratch[8 * words], &scratch[9 * words], &scratch[10 * words]};
+    const uint8_t weights[5] = {1, 2, 4, 8, mine_bit};
+
+    //Cell j of left holds bit j-1 of the row, cell j of right holds bit j+1
+    auto shift_row = [&](int row, int slot) {
+        const uint64_t *m = mines + (size_t)row * words;
+        for (int k = 0; k < words; k++) {
+            left[slot][k] = (m[k] << 1) | (k > 0 ? m[k - 1] >> 63 : 0);
+            right[slot][k] = (m[k] >> 1) | (k + 1 < words ? m[k + 1] << 63 : 0);
+        }
+    };
+    shift_row(0, 0);
+
+    for (int row = 0; row < height; row++) {
+        int up = (row + 2) % 3;
+        int mid = row % 3;
+        int down = (row + 1) % 3;
+        //Slot of row + 1 held row - 2, which is no longer needed
+        if (row + 1 < height) {
+            shift_row(row + 1, down);
+        }
+        bool has_up = row > 0;
+        bool has_down = row + 1 < height;
+        const uint64_t *in[8] = {
+            has_up ? left[up] : zero,
+            has_up ? mines + (size_t)(row - 1) * words : zero,
+            has_up ? right[up] : zero,
+            left[mid],
+            right[mid],
+            has_down ? left[down] : zero,
+            has_down ? mines + (size_t)(row + 1) * words : zero,
+            has_down ? right[down] : zero,
+        };
+        switch (kernel) {
+#ifdef COUNT_KERNEL_X86
+        case KERNEL_AVX2:
+            AddRowsAvx2(in, count, words);
+            break;
+        case KERNEL_SSE2:
+            AddRowsSse2(in, count, words);
+            break;
+#endif
+        default:
+            AddRowsScalar(in, count, 0, words);
+            break;
+        }
+
+        //Spread the count and mine bit planes to bytes
+        const uint64_t *const planes[5] = {count[0], count[1], count[2], count[3], mines + (size_t)row * words};
+        uint8_t *out = cells + (size_t)row * width;
+#ifdef COUNT_KERNEL_X86
+        if (kernel == KERNEL_AVX2) {
+            SpreadRowAvx2(planes, weights, width, out);
+            continue;
+        }
+#endif
+        SpreadRowScalar(planes, weights, 0, width, out);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef COUNTKERNEL_H
+#define COUNTKERNEL_H
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Implementations of the neighbour count kernel
+ */
+enum CountKernel {
+    //Portable, 64 cells per step
+    KERNEL_SCALAR,
+    //128 cells per step
+    KERNEL_SSE2,
+    //256 cells per step
+    KERNEL_AVX2,
+};
+
+/**
+ * Table mapping a byte to a 64-bit word holding its bit i in the low bit of byte i
+ */
+extern const std::array<uint64_t, 256> SPREAD_BYTES;
+
+CountKernel SelectCountKernel();
+void CountNeighbourMines(const uint64_t *, int, int, uint8_t, uint8_t *, CountKernel kernel = SelectCountKernel());
+
+#endif
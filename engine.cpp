@@ -0,0 +1,51 @@
+#include "protocol.h"
+#include <iostream>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#endif
+using namespace std;
+
+/**
+ * Headless engine for bots, built as minesweeper_engine. Reads protocol commands from stdin and
+ * writes one reply line each to stdout, see ProtocolEngine for the commands.
+ *
+ * Replies are buffered and only flushed once no further input is waiting, so a bot sending a
+ * batch of moves gets all replies in one write while a bot waiting for each reply gets it at once.
+ */
+
+/**
+ * @return true if more input can be read without blocking
+ */
+bool InputPending() {
+    if (cin.rdbuf()->in_avail() > 0) {
+        return true;
+    }
+#ifdef _WIN32
+    //Pipes can be peeked, for a console assume nothing is waiting
+    DWORD available = 0;
+    return PeekNamedPipe(GetStdHandle(STD_INPUT_HANDLE), NULL, 0, NULL, &available, NULL) && available > 0;
+#else
+    pollfd input{0, POLLIN, 0};
+    return poll(&input, 1, 0) > 0;
+#endif
+}
+
+int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    ProtocolEngine engine;
+    string line;
+    while (getline(cin, line)) {
+        if (!engine.Execute(line, cout)) {
+            break;
+        }
+        if (!InputPending()) {
+            cout.flush();
+        }
+    }
+    cout.flush();
+    return 0;
+}
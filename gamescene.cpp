@@ -1,19 +1,21 @@
 #ifndef GAMESCENE_CPP
 #define GAMESCENE_CPP
 
-#include "logic.cpp"
+#include "logic.h"
+#include "replay.h"
 #include "scene.cpp"
 #include "texture.cpp"
-#include <SDL2\SDL.h>
-#include <SDL2\SDL_image.h>
-#include <SDL2\SDL_ttf.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
 
 /**
  * Displays the game
  */
 class GameScene : public Scene {
 public:
-    GameScene(SDL_Window *, Level, TTF_Font *);
+    GameScene(SDL_Window *, Level, GlyphAtlas *);
+    GameScene(SDL_Window *, uint16_t, uint16_t, uint32_t, GlyphAtlas *);
 
     /**
      * List of possible cell states
@@ -46,10 +48,18 @@ public:
     void Render();
     void Free();
     void HandleEvent(SDL_Event *);
+    bool IsDirty();
+    Sint32 GetRedrawDelay();
 
 private:
     const static std::string sprite_path;
+    const static std::string save_path;
+    const static std::string replay_path;
     const static int c_length = 20;
+    //Side of each tile in sprite_path, shrunk to c_length on load
+    const static int sprite_tile = 200;
+    //Moves between keyframes of saved replays
+    const static int replay_keyframes = 500;
     const static int board_x_pos = 0;
     const static int board_y_pos = c_length * 3;
 
@@ -61,48 +71,93 @@ private:
     Texture tile_sheet_texture;
     SDL_Rect tile_sheet_clips[CELL_TOTAL];
 
-    Texture unflagged_mines_texture;
+    //Board drawn once and kept between frames. Only cells changed by moves are drawn again, or the
+    //whole board when board_stale (new size, loaded game, lost render targets).
+    Texture board_texture;
+    std::vector<int> dirty_cells;
+    bool board_stale{true};
+    //Size of board_texture the renderer could not render to, drawn directly without trying again
+    SDL_Point failed_target{0, 0};
 
-    Texture timer_texture;
+    const static SDL_Color text_color;
+
+    //Seconds shown by the timer, frozen once the game ends
+    Uint32 timer_seconds{0};
     Uint32 start_time{0};
-    GameState curr_state;
+    //Milliseconds played when the game ended, kept until an undo resumes play
+    Uint32 stopped_elapsed{0};
+    GameState curr_state{PLAYING};
+    //Practice mode allows undo and redo, also after a loss
+    bool practice{false};
+
+    //Moves of the game, written to replay_path when it ends. Stops once the game is no longer
+    //played straight through (undo, redo or a loaded save).
+    Replay replay;
+    bool recording{true};
 
+    void Init();
     bool LoadMedia();
+    void DrawCell(int, int, int, int);
+    void UpdateBoardTexture();
+    void MarkChanges();
+    void SetState(GameState);
+    Uint32 GetElapsed();
+    void RecordMove(ReplayAction, int, int);
 };
 
-const string GameScene::sprite_path = "sprite.png";
+const std::string GameScene::sprite_path = "sprite.png";
+const std::string GameScene::save_path = "minesweeper.sav";
+const std::string GameScene::replay_path = "minesweeper.replay";
+const SDL_Color GameScene::text_color = SDL_Color{0, 0, 0, 255};
 
 /**
  * Creates a new game based on indicated difficulty
  * @param window SDL_Window pointer to load scene
  * @param difficulty @c Level::EASY or @c Level::NORMAL or @c Level::HARD each with predefined rows, columns and mines.
- * @param font Font used to render text
+ * @param text Text renderer
+ */
+GameScene::GameScene(SDL_Window *window, Level difficulty, GlyphAtlas *text) : Scene(window, text) {
+    current_board = new Board{difficulty, RandomSeed(), FIRST_CLICK_OPENING};
+    Init();
+}
+
+/**
+ * Creates a new game on a custom board
+ * @param window SDL_Window pointer to load scene
+ * @param height number of rows
+ * @param width number of columns
+ * @param mines number of mines
+ * @param text Text renderer
+ */
+GameScene::GameScene(SDL_Window *window, uint16_t height, uint16_t width, uint32_t mines, GlyphAtlas *text) : Scene(window, text) {
+    current_board = new Board{height, width, mines, RandomSeed(), FIRST_CLICK_OPENING};
+    Init();
+}
+
+/**
+ * Sets up textures, clips and the replay for current_board
  */
-GameScene::GameScene(SDL_Window *window, Level difficulty, TTF_Font *font) : Scene(window, font) {
-    g_renderer = SDL_GetRenderer(window);
-    current_board = new Board{difficulty};
+void GameScene::Init() {
+    g_renderer = SDL_GetRenderer(g_window);
+    //Kept for practice mode undo and redo
+    current_board->EnableJournal();
+    replay.height = current_board->GetHeight();
+    replay.width = current_board->GetWidth();
+    replay.mines = current_board->GetFlagsLeft();
+    replay.seed = current_board->GetSeed();
+    replay.first_click = current_board->GetFirstClick();
     SetWindowSize(c_length * current_board->GetWidth(), c_length * current_board->GetHeight() + board_y_pos);
 
     // Load Textures
     if (!LoadMedia()) {
         std::cerr << "Failed to load media!" << std::endl;
     }
-    unflagged_mines_texture.LoadFromRenderedText(g_font, g_renderer, std::to_string(current_board->GetFlagsLeft()), new SDL_Color{0, 0, 0, 255});
-    timer_texture.LoadFromRenderedText(g_font, g_renderer, "0", new SDL_Color{0, 0, 0, 255});
-
-    // Set clips
-    tile_sheet_clips[CELL_0] = SDL_Rect{0, 0, 200, 200};
-    tile_sheet_clips[CELL_1] = SDL_Rect{200, 0, 200, 200};
-    tile_sheet_clips[CELL_2] = SDL_Rect{400, 0, 200, 200};
-    tile_sheet_clips[CELL_3] = SDL_Rect{600, 0, 200, 200};
-    tile_sheet_clips[CELL_4] = SDL_Rect{800, 0, 200, 200};
-    tile_sheet_clips[CELL_5] = SDL_Rect{1000, 0, 200, 200};
-    tile_sheet_clips[CELL_6] = SDL_Rect{1200, 0, 200, 200};
-    tile_sheet_clips[CELL_7] = SDL_Rect{1400, 0, 200, 200};
-    tile_sheet_clips[CELL_8] = SDL_Rect{1600, 0, 200, 200};
-    tile_sheet_clips[CELL_MINE] = SDL_Rect{2200, 0, 200, 200};
-    tile_sheet_clips[CELL_UNFLAGGED] = SDL_Rect{1800, 0, 200, 200};
-    tile_sheet_clips[CELL_FLAGGED] = SDL_Rect{2000, 0, 200, 200};
+
+    // Set clips, by tile position in the sprite
+    const int sprite_order[CELL_TOTAL] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 11, 9, 10};
+    for (int i = 0; i < CELL_TOTAL; i++) {
+        tile_sheet_clips[i] = SDL_Rect{sprite_order[i] * c_length, 0, c_length, c_length};
+    }
 
     // Default key pressed to false
     for (int i = 0; i < KEY_MOUSE_TOTAL; i++) {
@@ -112,40 +167,127 @@ GameScene::GameScene(SDL_Window *window, Level difficulty, TTF_Font *font) : Sce
     start_time = 0;
 }
 
+/**
+ * @return true if the scene changed since the last Render, including the timer reaching a new second
+ */
+bool GameScene::IsDirty() {
+    return dirty || (start_time && curr_state == PLAYING && (SDL_GetTicks() - start_time) / 1000 != timer_seconds);
+}
+
+/**
+ * @return milliseconds until the timer shows the next second, or -1 if it is stopped
+ */
+Sint32 GameScene::GetRedrawDelay() {
+    if (!start_time || curr_state != PLAYING) {
+        return -1;
+    }
+    return 1000 - (SDL_GetTicks() - start_time) % 1000;
+}
+
 /**
  * Transforms the current grid to a rendered image.
  */
 void GameScene::Render() {
     // Draw unflagged mines
-    unflagged_mines_texture.Render(g_renderer, 10, 10);
+    g_text->Render(g_renderer, std::to_string(current_board->GetFlagsLeft()), 10, 10, text_color);
 
-    // Load timer if started and still playing
+    // Update timer if started and still playing
     if (start_time && curr_state == GameState::PLAYING) {
-        const std::string curr_time = std::to_string((SDL_GetTicks() - start_time) / 1000);
-        timer_texture.LoadFromRenderedText(g_font, g_renderer, curr_time, new SDL_Color{0, 0, 0, 255});
+        timer_seconds = GetElapsed() / 1000;
     }
     // Draw timer
+    const std::string curr_time = std::to_string(timer_seconds);
     int width;
     SDL_GetWindowSize(g_window, &width, NULL);
-    timer_texture.Render(g_renderer, width - timer_texture.GetWidth() - 10, 10);
-
-    // Draw game board
-    auto grid = current_board->GetPlayerGrid(); //Current Player State
-    SDL_Rect dest{0, 0, c_length, c_length};    //Specifies where each cell is displayed on renderer
-    CellState c_state;
-    for (int row = 0; row < grid.size(); row++) {
-        dest.y = c_length * row + board_y_pos; //Updates y value whenever a new row.
-        for (int col = 0; col < grid[0].size(); col++) {
-            dest.x = c_length * col;             //Updates x value whenever a new col
-            c_state = (CellState)grid[row][col]; //Cell state of current cell
-            // Draw background under mines
-            if (c_state == CELL_MINE) {
-                tile_sheet_texture.Render(g_renderer, &tile_sheet_clips[CELL_0], &dest);
+    g_text->Render(g_renderer, curr_time, width - g_text->GetWidth(curr_time) - 10, 10, text_color);
+
+    // Draw game board, from the retained texture when the renderer supports it
+    UpdateBoardTexture();
+    if (board_texture.IsLoaded()) {
+        board_texture.Render(g_renderer, board_x_pos, board_y_pos);
+        return;
+    }
+    GridView grid = current_board->GetView(); //Current Player State, not copied
+    for (int row = 0; row < grid.GetHeight(); row++) {
+        for (int col = 0; col < grid.GetWidth(); col++) {
+            DrawCell(row, col, c_length * col + board_x_pos, c_length * row + board_y_pos);
+        }
+    }
+}
+
+/**
+ * Draws the sprite of cell (row, col) at (x, y) on the current render target
+ */
+void GameScene::DrawCell(int row, int col, int x, int y) {
+    const SDL_Rect dest{x, y, c_length, c_length};
+    CellState c_state = (CellState)current_board->GetView().At(row, col);
+    // Draw background under mines
+    if (c_state == CELL_MINE) {
+        tile_sheet_texture.Render(g_renderer, &tile_sheet_clips[CELL_0], &dest);
+    }
+    // Draw corresponding sprite
+    tile_sheet_texture.Render(g_renderer, &tile_sheet_clips[c_state], &dest);
+}
+
+/**
+ * Brings board_texture up to date: redraws every cell if stale, else only dirty_cells. Leaves
+ * board_texture empty if the renderer cannot render to textures, so Render draws cells directly.
+ * A size that failed once is not tried again until the render device is reset.
+ */
+void GameScene::UpdateBoardTexture() {
+    const int width = current_board->GetWidth();
+    const int height = current_board->GetHeight();
+    const SDL_Point size{c_length * width, c_length * height};
+    if (!board_stale && dirty_cells.empty()) {
+        return;
+    }
+    if (size.x == failed_target.x && size.y == failed_target.y) {
+        board_stale = false;
+        dirty_cells.clear();
+        return;
+    }
+    if (board_stale && (board_texture.GetWidth() != size.x || board_texture.GetHeight() != size.y)) {
+        board_texture.CreateTarget(g_renderer, size.x, size.y);
+    }
+    if (!board_texture.IsLoaded() || !board_texture.SetAsTarget(g_renderer)) {
+        board_texture.Free();
+        failed_target = size;
+        board_stale = false;
+        dirty_cells.clear();
+        return;
+    }
+    //Clear under the cells, sprites are transparent where white
+    SDL_SetRenderDrawColor(g_renderer, 0xff, 0xff, 0xff, 0xff);
+    if (board_stale) {
+        SDL_RenderClear(g_renderer);
+        for (int row = 0; row < height; row++) {
+            for (int col = 0; col < width; col++) {
+                DrawCell(row, col, c_length * col, c_length * row);
             }
-            // Draw corresponding sprite
-            tile_sheet_texture.Render(g_renderer, &tile_sheet_clips[c_state], &dest);
+        }
+    } else {
+        std::vector<SDL_Rect> rects;
+        rects.reserve(dirty_cells.size());
+        for (int index : dirty_cells) {
+            rects.push_back(SDL_Rect{c_length * (index % width), c_length * (index / width), c_length, c_length});
+        }
+        SDL_RenderFillRects(g_renderer, rects.data(), rects.size());
+        Texture::draw_calls++;
+        for (int index : dirty_cells) {
+            DrawCell(index / width, index % width, c_length * (index % width), c_length * (index / width));
         }
     }
+    SDL_SetRenderTarget(g_renderer, NULL);
+    board_stale = false;
+    dirty_cells.clear();
+}
+
+/**
+ * Queues the cells changed by the last move for UpdateBoardTexture
+ */
+void GameScene::MarkChanges() {
+    const std::vector<int> &changes = current_board->GetChanges();
+    dirty_cells.insert(dirty_cells.end(), changes.begin(), changes.end());
 }
 
 /**
@@ -155,17 +297,63 @@ void GameScene::Free() {
     g_renderer = NULL;
     current_board = NULL;
     tile_sheet_texture.Free();
-    unflagged_mines_texture.Free();
-    timer_texture.Free();
+    board_texture.Free();
 }
 
 /**
  * Handle event and updates game logic
  */
 void GameScene::HandleEvent(SDL_Event *e) {
+    //Every key and click may change the board, counter or timer
+    if (e->type == SDL_KEYUP || e->type == SDL_MOUSEBUTTONDOWN || e->type == SDL_MOUSEBUTTONUP) {
+        dirty = true;
+    }
+    //Render targets lose their contents, e.g. when a Direct3D window is resized
+    if (e->type == SDL_RENDER_TARGETS_RESET) {
+        board_stale = true;
+        dirty = true;
+    }
+    //Every texture is lost with the device, load them again
+    if (e->type == SDL_RENDER_DEVICE_RESET) {
+        board_texture.Free();
+        failed_target = SDL_Point{0, 0};
+        if (!LoadMedia()) {
+            std::cerr << "Failed to load media!" << std::endl;
+        }
+        board_stale = true;
+        dirty = true;
+    }
     //Switch to menu
     if (e->type == SDL_KEYUP && e->key.keysym.sym == SDLK_ESCAPE) {
         SceneManager::Transition(Scene::SCENE_MENU);
+    } else if (e->type == SDL_KEYUP && e->key.keysym.sym == SDLK_s) {
+        if (!current_board->Save(save_path, GetElapsed())) {
+            std::cerr << "Failed to save game!" << std::endl;
+        }
+    } else if (e->type == SDL_KEYUP && e->key.keysym.sym == SDLK_l) {
+        Uint32 elapsed = 0;
+        if (current_board->Load(save_path, elapsed)) {
+            recording = false;
+            curr_state = current_board->GetState();
+            board_stale = true;
+            //Resume the timer where it was saved, or start it on the next click
+            start_time = elapsed ? SDL_GetTicks() - elapsed : 0;
+            stopped_elapsed = elapsed;
+            SetWindowSize(c_length * current_board->GetWidth(), c_length * current_board->GetHeight() + board_y_pos);
+            timer_seconds = elapsed / 1000;
+        } else {
+            std::cerr << "Failed to load game!" << std::endl;
+        }
+    } else if (e->type == SDL_KEYUP && e->key.keysym.sym == SDLK_p) {
+        practice = !practice;
+    } else if (practice && e->type == SDL_KEYUP && (e->key.keysym.sym == SDLK_z || e->key.keysym.sym == SDLK_y)) {
+        //Z steps back a move, Y steps forward again
+        bool stepped = e->key.keysym.sym == SDLK_z ? current_board->Undo() : current_board->Redo();
+        if (stepped) {
+            MarkChanges();
+            recording = false;
+            SetState(current_board->GetState());
+        }
     } else if (curr_state == PLAYING) { //If still playing then handle events
         switch (e->type) {
         case SDL_MOUSEBUTTONDOWN:
@@ -180,13 +368,13 @@ void GameScene::HandleEvent(SDL_Event *e) {
                     if (e->button.x >= board_x_pos && e->button.y >= board_y_pos) {
                         int col = (e->button.x - board_x_pos) / c_length;
                         int row = (e->button.y - board_y_pos) / c_length;
-                        current_board->Flag(row, col);
-                        //Update unflagged mines
-                        unflagged_mines_texture.LoadFromRenderedText(g_font, g_renderer, std::to_string(current_board->GetFlagsLeft()), new SDL_Color{0, 0, 0, 255});
                         //Start timer if not started
                         if (start_time == 0) {
                             start_time = SDL_GetTicks();
                         }
+                        current_board->Flag(row, col);
+                        MarkChanges();
+                        RecordMove(REPLAY_FLAG, row, col);
                     }
                 }
                 break;
@@ -201,11 +389,13 @@ void GameScene::HandleEvent(SDL_Event *e) {
                     if (e->button.x >= board_x_pos && e->button.y >= board_y_pos) {
                         int col = (e->button.x - board_x_pos) / c_length;
                         int row = (e->button.y - board_y_pos) / c_length;
-                        curr_state = current_board->Open(row, col);
                         //Start timer if not started
                         if (start_time == 0) {
                             start_time = SDL_GetTicks();
                         }
+                        SetState(current_board->Open(row, col));
+                        MarkChanges();
+                        RecordMove(REPLAY_OPEN, row, col);
                     }
                 }
                 break;
@@ -219,15 +409,58 @@ void GameScene::HandleEvent(SDL_Event *e) {
 }
 
 /**
- * Loads the sprite to texture and sets the clips corresponding to cell state.
+ * Loads the sprite to texture, with tiles scaled to c_length so cells are copied without scaling.
  */
 bool GameScene::LoadMedia() {
     // Load tile sheet texture
-    if (!tile_sheet_texture.LoadFromFile(g_renderer, sprite_path)) {
+    if (!tile_sheet_texture.LoadScaledTiles(g_renderer, sprite_path, sprite_tile, c_length)) {
         std::cerr << "Sprite loading failed!" << std::endl;
         return false;
     }
     return true;
 }
 
+/**
+ * Updates the game state, stopping the timer when the game ends and resuming it where it stopped
+ * when an undo takes a finished game back into play
+ */
+void GameScene::SetState(GameState state) {
+    if (curr_state == PLAYING && state != PLAYING) {
+        stopped_elapsed = GetElapsed();
+    } else if (curr_state != PLAYING && state == PLAYING && start_time) {
+        start_time = SDL_GetTicks() - stopped_elapsed;
+    }
+    curr_state = state;
+    timer_seconds = GetElapsed() / 1000;
+}
+
+/**
+ * @return milliseconds played, frozen once the game has ended
+ */
+Uint32 GameScene::GetElapsed() {
+    if (!start_time) {
+        return 0;
+    }
+    return curr_state == PLAYING ? SDL_GetTicks() - start_time : stopped_elapsed;
+}
+
+/**
+ * Adds a move to the replay, timed from the first move, and writes the replay once the game ends
+ */
+void GameScene::RecordMove(ReplayAction action, int row, int col) {
+    if (!recording) {
+        return;
+    }
+    Uint32 time = GetElapsed();
+    replay.moves.push_back({time, action, row * replay.width + col});
+    if (curr_state != PLAYING) {
+        replay.result = curr_state;
+        replay.duration = time;
+        recording = false;
+        if (!SaveReplay(replay, replay_path, replay_keyframes)) {
+            std::cerr << "Failed to save replay!" << std::endl;
+        }
+    }
+}
+
 #endif
\ No newline at end of file
@@ -1,232 +1,241 @@
-#ifndef LOGIC_CPP
-#define LOGIC_CPP
-
-#include <algorithm> //To random shuffle
-#include <array>
+#include "logic.h"
+#include "countkernel.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <vector>
 using namespace std;
 
 /**
- * Available difficulty levels.
+ * Creates an empty table, assign a sized one before use
  */
-enum Level {
-    // 9x9 with 10 mines.
-    EASY,
-    // 16x16 with 40 mines.
-    NORMAL,
-    // 16x30 with 99 mines.
-    HARD,
-};
-
-enum GameState {
-    //Game in progress
-    PLAYING,
-    //Bombs successfully flagged
-    WON,
-    //Bomb exploded
-    LOST
-};
+NeighbourTable::NeighbourTable() : NeighbourTable(0, 0) {}
 
-class Board {
-public:
-    //Constructors
-    Board(Level);
-    Board(uint8_t, uint8_t, uint16_t);
-
-    //Getters
-    vector<vector<int>> GetPlayerGrid();
-    // vector<vector<int>> GetAnswerGrid();
-    vector<array<int, 2>> GetWrongFlags();
-    int GetHeight();
-    int GetWidth();
-    int GetMoves();
-    int GetFlagsLeft();
-
-    //Setters?
-    void Flag(int, int);
-    GameState Open(int, int, bool);
-
-private:
-    //Members
-    int height;
-    int width;
-    int bomb_size;
-    int moves = 0;
-    int flags = 0;
-    GameState game_state = PLAYING;
-    vector<vector<int>> player_grid;
-    vector<vector<int>> answer_grid;
-    vector<array<int, 2>> wrong_flags;
-
-    //Functions
-    void Initialise();
-    void PopulateAnswerGrid();
-    void AppendBomb(vector<array<int, 2>> bomb_coords);
-    void UpdateGameStatus();
-    vector<array<int, 2>> GetNeighbours(int row, int col);
-};
+/**
+ * @param height the height of grid
+ * @param width the width of grid
+ */
+NeighbourTable::NeighbourTable(int height, int width) : height{height}, width{width} {
+    offsets = {-width - 1, -width, -width + 1, -1, 1, width - 1, width, width + 1};
+}
 
 /**
- * Generates grid based on specified difficulty
+ * Dimensions of a preset
  * @param difficulty EASY, NORMAL, HARD
  */
-Board::Board(Level difficulty) {
+DynamicShape DynamicShape::Preset(Level difficulty) {
     switch (difficulty) {
-    case EASY: {
-        height = 9;
-        width = 9;
-        bomb_size = 10;
-        break;
+    case NORMAL:
+        return {16, 16, 40};
+    case HARD:
+        return {16, 30, 99};
+    default:
+        return {9, 9, 10};
     }
-    case NORMAL: {
-        height = 16;
-        width = 16;
-        bomb_size = 40;
-        break;
-    }
-    case HARD: {
-        height = 16;
-        width = 30;
-        bomb_size = 99;
-        break;
-    }
-    }
-    Initialise();
 }
 
 /**
- * Custom difficulty
+ * Custom dimensions
  * @param height the height of grid
  * @param width the width of grid
  * @param bomb_size the number of bombs
+ * @return the dimensions, or easy mode if they are invalid
  */
-Board::Board(uint8_t h, uint8_t w, uint16_t bs) {
+DynamicShape DynamicShape::Custom(uint16_t h, uint16_t w, uint32_t bs) {
     //Invalid input handling, default to easy mode
-    if (h == 0 || w == 0 || bs == 0 || bs >= h * w) {
-        height = 9;
-        width = 9;
-        bomb_size = 10;
-    } else {
-        height = h;
-        width = w;
-        bomb_size = bs;
+    DynamicShape shape;
+    shape.Resize(h, w, bs);
+    return shape;
+}
+
+/**
+ * Sets the dimensions if they are valid
+ * @return false if they are not, the dimensions are then unchanged
+ */
+bool DynamicShape::Resize(int h, int w, int bs) {
+    int64_t cell_count = (int64_t)h * w;
+    if (h <= 0 || w <= 0 || h > UINT16_MAX || w > UINT16_MAX || bs <= 0 || bs >= cell_count || cell_count > Board::MAX_CELLS) {
+        return false;
     }
+    height = h;
+    width = w;
+    bomb_size = bs;
+    return true;
+}
+
+/**
+ * Generates grid based on specified difficulty
+ * @param difficulty EASY, NORMAL, HARD
+ * @param seed seed of mine placement, the same seed (and first click, unless FIRST_CLICK_ANY)
+ * always gives the same board
+ * @param first_click when mines are placed, see FirstClick
+ */
+Board::Board(Level difficulty, uint64_t seed, FirstClick first_click) : BasicBoard(::DynamicShape::Preset(difficulty), seed, first_click) {}
+
+/**
+ * Custom difficulty, invalid input falls back to easy mode
+ * @param height the height of grid
+ * @param width the width of grid
+ * @param bomb_size the number of bombs
+ * @param seed seed of mine placement, the same seed (and first click, unless FIRST_CLICK_ANY)
+ * always gives the same board
+ * @param first_click when mines are placed, see FirstClick
+ */
+Board::Board(uint16_t h, uint16_t w, uint32_t bs, uint64_t seed, FirstClick first_click) : BasicBoard(::DynamicShape::Custom(h, w, bs), seed, first_click) {}
+
+/**
+ * Generates a board of a fixed shape, or an easy board for DynamicShape
+ * @param seed seed of mine placement, see Board
+ * @param first_click when mines are placed, see FirstClick
+ */
+template <typename Shape>
+BasicBoard<Shape>::BasicBoard(uint64_t seed, FirstClick first_click) : BasicBoard(Shape(), seed, first_click) {}
+
+/**
+ * Generates a board of the given shape
+ * @param shape dimensions of the board
+ * @param seed seed of mine placement, see Board
+ * @param first_click when mines are placed, see FirstClick
+ */
+template <typename Shape>
+BasicBoard<Shape>::BasicBoard(const Shape &shape, uint64_t seed, FirstClick first_click) : Shape(shape), seed{seed}, first_click{first_click} {
     Initialise();
 }
 
 //Getters
-vector<vector<int>> Board::GetPlayerGrid() {
-    return player_grid;
+template <typename Shape>
+vector<vector<int>> BasicBoard<Shape>::GetPlayerGrid() {
+    GridView view = GetView();
+    vector<vector<int>> grid(height, vector<int>(width));
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            grid[i][j] = view.At(i, j);
+        }
+    }
+    return grid;
 }
 // vector<vector<int>> Board::GetAnswerGrid() {
 //     return answer_grid;
 // }
-vector<array<int, 2>> Board::GetWrongFlags() {
+template <typename Shape>
+vector<array<int, 2>> BasicBoard<Shape>::GetWrongFlags() {
+    vector<array<int, 2>> wrong_flags;
+    for (int i = 0; i < height * width; i++) {
+        if ((cells[i] & (CELL_FLAG | CELL_MINE)) == CELL_FLAG) {
+            wrong_flags.push_back({i / width, i % width});
+        }
+    }
     return wrong_flags;
 }
-int Board::GetHeight() {
+template <typename Shape>
+int BasicBoard<Shape>::GetHeight() {
     return height;
 }
-int Board::GetWidth() {
+template <typename Shape>
+int BasicBoard<Shape>::GetWidth() {
     return width;
 }
-int Board::GetMoves() {
+template <typename Shape>
+int BasicBoard<Shape>::GetMoves() {
     return moves;
 }
-int Board::GetFlagsLeft() {
+template <typename Shape>
+int BasicBoard<Shape>::GetFlagsLeft() {
     return max(0, bomb_size - flags);
 }
+template <typename Shape>
+uint64_t BasicBoard<Shape>::GetSeed() {
+    return seed;
+}
+template <typename Shape>
+FirstClick BasicBoard<Shape>::GetFirstClick() {
+    return first_click;
+}
+template <typename Shape>
+GameState BasicBoard<Shape>::GetState() {
+    return game_state;
+}
+/**
+ * @return view of the player grid that does not copy the cells
+ */
+template <typename Shape>
+GridView BasicBoard<Shape>::GetView() {
+    return GridView{cells.data(), height, width, &game_state};
+}
+/**
+ * @return flat indices (row * width + col) of the cells whose visible state changed in the last
+ * Open or Flag. Cells revealed by Open are in reveal order.
+ */
+template <typename Shape>
+const vector<int> &BasicBoard<Shape>::GetChanges() {
+    return changes;
+}
 //Actions
 /**
  * Flag/Unflag cell (row, col) only if cell is unopened/flagged
  */
-void Board::Flag(int row, int col) {
-    if (player_grid[row][col] == 10) {
-        player_grid[row][col] = 11;
-        moves += 1;
-        flags += 1;
-        if (answer_grid[row][col] != 9) {
-            wrong_flags.push_back({row, col});
-        }
-    } else if (player_grid[row][col] == 11) {
-        player_grid[row][col] = 10;
-        moves += 1;
-        flags -= 1;
-        for (int i = 0; i < wrong_flags.size(); i++) {
-            if (wrong_flags[i][0] == row && wrong_flags[i][1] == col) {
-                wrong_flags.erase(wrong_flags.begin() + i);
-            }
-        }
+template <typename Shape>
+void BasicBoard<Shape>::Flag(int row, int col) {
+    changes.clear();
+    int index = row * width + col;
+    if (cells[index] & CELL_OPEN) {
+        return;
     }
+    changes.push_back(index);
+    ToggleFlag(index);
+    moves += 1;
+    Record(index, true, game_state, moves - 1);
 }
 
 /**
  * Opens cell (row, col)
  * If cell unopened -> opens cell
- * - If opened cell = 0 -> recursively opens neighbouring cells
+ * - If opened cell = 0 -> flood fills the connected area of 0 cells and its border
  * - If opened cell = 9 -> Bomb opened, game over
  * If cell already opened -> Open all neighbour cells if no. of flagged neighbouring = no. on cell
- * Increment move count by 1 (only for open cell called by user)
+ * Increment move count by 1, unless nothing could be opened
  */
-GameState Board::Open(int row, int col, bool recursive = false) {
-    if (recursive == false) {
-        moves += 1;
-    }
+template <typename Shape>
+GameState BasicBoard<Shape>::Open(int row, int col) {
+    changes.clear();
+    GameState state_before = game_state;
+    int moves_before = moves;
+    moves += 1;
 
-    int cell = player_grid[row][col];
-    int ans = answer_grid[row][col];
+    int index = row * width + col;
+    if (!placed && !(cells[index] & CELL_FLAG)) {
+        PlaceMines(index);
+    }
+    uint8_t cell = cells[index];
 
     //Open cell if cell is unopened
-    if (cell == 10) {
-        player_grid[row][col] = ans;
-
-        //End game if bomb cell is opened, display answer
-        if (ans == 9) {
-            player_grid = answer_grid;
-            game_state = LOST;
-            return game_state;
-        }
-        //Else recursively open neighbours of 0 cell
-        else if (ans == 0) {
-            vector<array<int, 2>> neighbours = GetNeighbours(row, col);
-            for (int i = 0; i < neighbours.size(); i++) {
-                int r = neighbours[i][0];
-                int c = neighbours[i][1];
-                if (player_grid[r][c] == 10) {
-                    Open(r, c, true);
-                }
-            }
-        } //Else do nothing
+    if ((cell & (CELL_OPEN | CELL_FLAG)) == 0) {
+        Reveal(index);
     }
     /** 
      * If cell is already open, check if no. of flagged neighbours = no. on cell
      * Open all unopened & unflagged neighbours if true
      */
-    else if (cell != 11) { //If cell is opened and unflagged
+    else if (cell & CELL_OPEN) { //If cell is opened and unflagged
         //Count no. of flagged neighbours
-        vector<array<int, 2>> neighbours = GetNeighbours(row, col);
         int flag_count = 0;
-        for (int i = 0; i < neighbours.size(); i++) {
-            int r = neighbours[i][0];
-            int c = neighbours[i][1];
-            if (player_grid[r][c] == 11) {
+        neighbours.ForEach(index, [&](int n) {
+            if (cells[n] & CELL_FLAG) {
                 flag_count += 1;
             }
-        }
+        });
         //If no. of flagged neighbours = no. on cell, open all unopened neighbours
-        if (flag_count == cell) {
-            int unopened = 0;
-            for (int i = 0; i < neighbours.size(); i++) {
-                int r = neighbours[i][0];
-                int c = neighbours[i][1];
-                if (player_grid[r][c] == 10) {
-                    Open(r, c, true);
-                    unopened += 1;
+        if (flag_count == (cell & CELL_COUNT)) {
+            neighbours.ForEach(index, [&](int n) {
+                if (game_state != LOST && (cells[n] & (CELL_OPEN | CELL_FLAG)) == 0) {
+                    Reveal(n);
                 }
-            }
+            });
             //Do not count move if all neighbours are already opened
-            if (unopened == 0) {
+            if (changes.empty()) {
                 moves -= 1;
             }
         }
@@ -235,148 +244,683 @@ GameState Board::Open(int row, int col, bool recursive = false) {
     else {
         moves -= 1;
     }
-    UpdateGameStatus();
+    assert(CountersMatch());
+    if (game_state == PLAYING) {
+        UpdateGameStatus();
+    }
+    if (!changes.empty()) {
+        Record(index, false, state_before, moves_before);
+    }
     return game_state;
 }
 
+/**
+ * Takes back the last move that changed the board, restoring the cells, counters and game state
+ * from before it. A lost game can be undone. Mines placed by a deferred first Open stay placed.
+ * Needs EnableJournal before the moves to undo.
+ * @return false if there is nothing to undo
+ */
+template <typename Shape>
+bool BasicBoard<Shape>::Undo() {
+    if (journal_size == 0) {
+        return false;
+    }
+    journal_size -= 1;
+    Replay(journal[journal_size], false);
+    return true;
+}
+
+/**
+ * Plays the last undone move again, until a new move is made
+ * @return false if there is nothing to redo
+ */
+template <typename Shape>
+bool BasicBoard<Shape>::Redo() {
+    if (journal_size == journal.size()) {
+        return false;
+    }
+    journal_size += 1;
+    Replay(journal[journal_size - 1], true);
+    return true;
+}
+
+/**
+ * Starts keeping moves for Undo and Redo, from the next move on. Off by default so that
+ * simulations and benchmarks, which never undo, pay nothing per move.
+ */
+template <typename Shape>
+void BasicBoard<Shape>::EnableJournal() {
+    journaling = true;
+}
+
 //Functions
 /**
- * Initialises player_grid and answer_grid based on height, width and bomb_size
+ * Initialises the cell store based on height, width and bomb_size. Mines are placed here
+ * for FIRST_CLICK_ANY, otherwise on the first Open.
  */
-void Board::Initialise() {
-    for (int i = 0; i < height; i++) {
-        player_grid.push_back(vector<int>(width, 10));
-        answer_grid.push_back(vector<int>(width, 0));
+template <typename Shape>
+void BasicBoard<Shape>::Initialise() {
+    Shape::Allocate(cells);
+    unopened = height * width;
+    neighbours = Shape::MakeNeighbours();
+    if (first_click == FIRST_CLICK_ANY) {
+        PlaceMines(-1);
     }
-    PopulateAnswerGrid();
 }
 
 /**
- * Populate answer grid with random bomb locations and corresponding neighbour values
-*/
-void Board::PopulateAnswerGrid() {
-    //Obtain random location of bombs
-    vector<int> random_integer(height * width);
-    for (int i = 0; i < width * height; i++) {
-        random_integer[i] = i;
+ * Places the mines, sparing the first click as set by first_click. Flags set before the first
+ * click are kept.
+ * @param first flat index of the first click, -1 when placing at construction
+ */
+template <typename Shape>
+void BasicBoard<Shape>::PlaceMines(int first) {
+    placed = true;
+    vector<int> excluded;
+    if (first >= 0) {
+        excluded.push_back(first);
+        if (first_click == FIRST_CLICK_OPENING) {
+            neighbours.ForEach(first, [&](int n) {
+                excluded.push_back(n);
+            });
+            if (bomb_size > height * width - (int)excluded.size()) {
+                excluded.resize(1);
+            }
+        }
+    }
+    vector<int> flagged;
+    if (flags > 0) {
+        for (int i = 0; i < height * width; i++) {
+            if (cells[i] & CELL_FLAG) {
+                flagged.push_back(i);
+            }
+        }
     }
-    random_shuffle(random_integer.begin(), random_integer.end());
 
-    //Obtaining bomb coordinates based on playing grid size
-    vector<array<int, 2>> bomb_coords(bomb_size);
-    for (int i = 0; i < bomb_size; i++) {
-        bomb_coords[i] = {random_integer[i] / width, random_integer[i] % width};
+    BoardRng gen{seed};
+    PopulateAnswerGrid(gen, excluded);
+
+    for (int index : flagged) {
+        cells[index] |= CELL_FLAG;
+        if (cells[index] & CELL_MINE) {
+            correct_flags += 1;
+        }
     }
-    AppendBomb(bomb_coords);
 }
 
 /**
- * Append bombs and neighbours values into grid
- * Increment neighbouring cells value by 1 with every bomb appended
+ * Reveals an unopened, unflagged cell. If it is a 0 cell, the connected area of 0 cells
+ * and its numbered border are revealed with an explicit work stack instead of recursion.
+ * Revealed cells are appended to changes.
+ * @param index flat index of cell to reveal
+ * @return number of cells revealed
  */
-void Board::AppendBomb(vector<array<int, 2>> bomb_coords) {
-    //Increment bomb neighbours by 1
-    for (auto coords : bomb_coords) {
-        vector<array<int, 2>> neighbours = GetNeighbours(coords[0], coords[1]);
-        for (auto x : neighbours) {
-            answer_grid[x[0]][x[1]] += 1;
+template <typename Shape>
+int BasicBoard<Shape>::Reveal(int index) {
+    int first = changes.size();
+    cells[index] |= CELL_OPEN;
+    changes.push_back(index);
+
+    //End game if bomb cell is opened, every unopened cell now shows its answer
+    if (cells[index] & CELL_MINE) {
+        unopened -= 1;
+        game_state = LOST;
+        for (int i = 0; i < height * width; i++) {
+            if (!(cells[i] & CELL_OPEN)) {
+                changes.push_back(i);
+            }
         }
+        return 1;
     }
 
-    // Set all bomb cells to 9
-    for (auto coords : bomb_coords) {
-        answer_grid[coords[0]][coords[1]] = 9;
+    reveal_stack.push_back(index);
+    while (!reveal_stack.empty()) {
+        int current = reveal_stack.back();
+        reveal_stack.pop_back();
+        //Only 0 cells spread to their neighbours
+        if (cells[current] & CELL_COUNT) {
+            continue;
+        }
+        neighbours.ForEach(current, [&](int n) {
+            //Neighbours of a 0 cell are never bombs
+            if ((cells[n] & (CELL_OPEN | CELL_FLAG)) == 0) {
+                cells[n] |= CELL_OPEN;
+                changes.push_back(n);
+                reveal_stack.push_back(n);
+            }
+        });
     }
+    int count = changes.size() - first;
+    unopened -= count;
+    revealed_safe += count;
+    return count;
 }
 
 /**
- * Check if winning condition has been met
+ * Header of a saved game, see BasicBoard::Save. Fields are in host byte order.
  */
-void Board::UpdateGameStatus() {
-    int count = 0;
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            if (player_grid[i][j] == 10 || player_grid[i][j] == 11) {
-                count += 1;
+struct SaveHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t height;
+    uint16_t width;
+    uint8_t first_click;
+    uint8_t placed;
+    uint8_t game_state;
+    uint8_t reserved[3];
+    uint32_t bomb_size;
+    int32_t moves;
+    uint64_t seed;
+    uint32_t elapsed_ms;
+    uint32_t reserved2;
+    //SaveChecksum over the header with this field zeroed, then the planes
+    uint64_t checksum;
+};
+static_assert(sizeof(SaveHeader) == 48, "SaveHeader must not be padded");
+
+const char SAVE_MAGIC[4] = {'M', 'S', 'W', 'P'};
+const uint16_t SAVE_VERSION = 1;
+
+/**
+ * Word-wise hash detecting corrupted or truncated saves
+ * @param hash hash of the preceding words
+ */
+static uint64_t SaveChecksum(uint64_t hash, const uint64_t *words, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        hash = (hash ^ words[i]) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+static uint64_t HeaderChecksum(SaveHeader header) {
+    header.checksum = 0;
+    uint64_t words[sizeof(SaveHeader) / 8];
+    memcpy(words, &header, sizeof(SaveHeader));
+    return SaveChecksum(1469598103934665603ULL, words, sizeof(SaveHeader) / 8);
+}
+
+/**
+ * Sets bit in every cell whose bit is set in a plane, eight cells per table lookup
+ * @param plane bit matrix laid out as for CountNeighbourMines
+ */
+static void SpreadPlane(const uint64_t *plane, int height, int width, uint8_t bit, uint8_t *cells) {
+    int words = (width + 63) / 64;
+    for (int row = 0; row < height; row++) {
+        uint8_t *row_cells = cells + (size_t)row * width;
+        for (int k = 0; k < words; k++) {
+            uint64_t word = plane[(size_t)row * words + k];
+            for (int col = k * 64; word != 0; col += 8, word >>= 8) {
+                uint64_t spread = SPREAD_BYTES[word & 0xff] * bit;
+                if (spread == 0) {
+                    continue;
+                }
+                if (col + 8 <= width) {
+                    uint64_t chunk;
+                    memcpy(&chunk, row_cells + col, 8);
+                    chunk |= spread;
+                    memcpy(row_cells + col, &chunk, 8);
+                } else {
+                    for (int i = 0; col + i < width; i++) {
+                        row_cells[col + i] |= (spread >> (8 * i)) & 0xff;
+                    }
+                }
             }
         }
     }
-    if (count == bomb_size) {
-        game_state = WON;
+}
+
+/**
+ * Writes the game to a file, see Save(vector<uint8_t> &, uint32_t)
+ * @param path file to write
+ * @param elapsed_ms time played so far, given back by Load
+ * @return false if the file could not be written
+ */
+template <typename Shape>
+bool BasicBoard<Shape>::Save(const string &path, uint32_t elapsed_ms) {
+    vector<uint8_t> data;
+    Save(data, elapsed_ms);
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write((const char *)data.data(), data.size());
+    out.close();
+    return !out.fail();
+}
+
+/**
+ * Appends a snapshot of the game: a SaveHeader followed by bit-planes, each a row-major bit
+ * matrix with rows padded to whole 64-bit words as for CountNeighbourMines. The mine plane comes
+ * first and only once the mines are placed (deferred boards place them from the seed), then the
+ * open and the flag plane. The undo journal is not saved.
+ * @param out buffer the snapshot is appended to
+ * @param elapsed_ms time played so far, given back by Load
+ */
+template <typename Shape>
+void BasicBoard<Shape>::Save(vector<uint8_t> &out, uint32_t elapsed_ms) {
+    int row_words = (width + 63) / 64;
+    size_t words = (size_t)height * row_words;
+    vector<uint64_t> planes((placed ? 3 : 2) * words, 0);
+    uint64_t *mine_plane = planes.data();
+    uint64_t *open_plane = mine_plane + (placed ? words : 0);
+    uint64_t *flag_plane = open_plane + words;
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            uint8_t cell = cells[row * width + col];
+            size_t k = (size_t)row * row_words + col / 64;
+            uint64_t bit = 1ULL << (col % 64);
+            if (placed && (cell & CELL_MINE)) {
+                mine_plane[k] |= bit;
+            }
+            if (cell & CELL_OPEN) {
+                open_plane[k] |= bit;
+            }
+            if (cell & CELL_FLAG) {
+                flag_plane[k] |= bit;
+            }
+        }
+    }
+
+    SaveHeader header{};
+    memcpy(header.magic, SAVE_MAGIC, 4);
+    header.version = SAVE_VERSION;
+    header.height = height;
+    header.width = width;
+    header.first_click = first_click;
+    header.placed = placed;
+    header.game_state = game_state;
+    header.bomb_size = bomb_size;
+    header.moves = moves;
+    header.seed = seed;
+    header.elapsed_ms = elapsed_ms;
+    header.checksum = SaveChecksum(HeaderChecksum(header), planes.data(), planes.size());
+
+    const uint8_t *header_bytes = (const uint8_t *)&header;
+    const uint8_t *plane_bytes = (const uint8_t *)planes.data();
+    out.insert(out.end(), header_bytes, header_bytes + sizeof(header));
+    out.insert(out.end(), plane_bytes, plane_bytes + planes.size() * sizeof(uint64_t));
+}
+
+/**
+ * Resumes a game written by Save. The file is memory mapped and loaded in place.
+ * @param path file to read
+ * @param elapsed_ms set to the time played so far
+ * @return false if the file is missing, corrupted or does not fit this board, which is then
+ * left unchanged
+ */
+template <typename Shape>
+bool BasicBoard<Shape>::Load(const string &path, uint32_t &elapsed_ms) {
+    MappedFile file{path};
+    return file.IsOpen() && Load(file.Data(), file.Size(), elapsed_ms);
+}
+
+/**
+ * Resumes a game from a snapshot written by Save. The cell store is built from the planes a
+ * word at a time: the counts come from CountNeighbourMines, the open and flag bits are spread
+ * eight cells per step, and the counters are popcounts of the planes.
+ * Fixed boards only load games of their own size.
+ * @param data snapshot, the whole of it
+ * @param size size of the snapshot in bytes
+ * @param elapsed_ms set to the time played so far
+ * @return false if the snapshot is corrupted or does not fit this board, which is then left
+ * unchanged
+ */
+template <typename Shape>
+bool BasicBoard<Shape>::Load(const uint8_t *data, size_t size, uint32_t &elapsed_ms) {
+    if (size < sizeof(SaveHeader)) {
+        return false;
+    }
+    SaveHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SAVE_MAGIC, 4) != 0 || header.version != SAVE_VERSION || header.placed > 1 ||
+        header.first_click > FIRST_CLICK_OPENING || header.game_state > LOST) {
+        return false;
+    }
+    Shape shape = *this;
+    if (!shape.Resize(header.height, header.width, header.bomb_size)) {
+        return false;
+    }
+    int row_words = (header.width + 63) / 64;
+    size_t words = (size_t)header.height * row_words;
+    size_t plane_count = header.placed ? 3 : 2;
+    if (size != sizeof(SaveHeader) + plane_count * words * sizeof(uint64_t)) {
+        return false;
+    }
+    //The header keeps the planes 8-byte aligned in a mapped file, snapshots inside other data
+    //may need a copy
+    const uint8_t *plane_bytes = data + sizeof(SaveHeader);
+    vector<uint64_t> aligned;
+    if ((uintptr_t)plane_bytes % alignof(uint64_t) != 0) {
+        aligned.resize(plane_count * words);
+        memcpy(aligned.data(), plane_bytes, aligned.size() * sizeof(uint64_t));
+        plane_bytes = (const uint8_t *)aligned.data();
+    }
+    const uint64_t *mine_plane = (const uint64_t *)plane_bytes;
+    const uint64_t *open_plane = mine_plane + (header.placed ? words : 0);
+    const uint64_t *flag_plane = open_plane + words;
+    if (SaveChecksum(HeaderChecksum(header), mine_plane, plane_count * words) != header.checksum) {
+        return false;
+    }
+
+    //Planes must describe a position Open and Flag could have reached
+    uint64_t row_mask = header.width % 64 ? (1ULL << (header.width % 64)) - 1 : ~0ULL;
+    int64_t mine_count = 0, open_count = 0, flag_count = 0, correct_count = 0, open_mines = 0;
+    for (size_t k = 0; k < words; k++) {
+        uint64_t valid = k % row_words == (size_t)row_words - 1 ? row_mask : ~0ULL;
+        uint64_t mine = header.placed ? mine_plane[k] : 0;
+        if (((mine | open_plane[k] | flag_plane[k]) & ~valid) || (open_plane[k] & flag_plane[k])) {
+            return false;
+        }
+        mine_count += bitset<64>(mine).count();
+        open_count += bitset<64>(open_plane[k]).count();
+        flag_count += bitset<64>(flag_plane[k]).count();
+        correct_count += bitset<64>(flag_plane[k] & mine).count();
+        open_mines += bitset<64>(open_plane[k] & mine).count();
+    }
+    int64_t cell_count = (int64_t)header.height * header.width;
+    GameState expected = open_mines > 0 ? LOST : open_count == cell_count - header.bomb_size ? WON : PLAYING;
+    if ((header.placed && mine_count != header.bomb_size) || (!header.placed && open_count > 0) || expected != header.game_state) {
+        return false;
+    }
+
+    static_cast<Shape &>(*this) = shape;
+    Shape::Allocate(cells);
+    neighbours = Shape::MakeNeighbours();
+    if (header.placed) {
+        CountNeighbourMines(mine_plane, height, width, CELL_MINE, cells.data());
+    }
+    SpreadPlane(open_plane, height, width, CELL_OPEN, cells.data());
+    SpreadPlane(flag_plane, height, width, CELL_FLAG, cells.data());
+    seed = header.seed;
+    first_click = (FirstClick)header.first_click;
+    placed = header.placed;
+    moves = header.moves;
+    flags = flag_count;
+    unopened = cell_count - open_count;
+    correct_flags = correct_count;
+    revealed_safe = open_count - open_mines;
+    game_state = (GameState)header.game_state;
+    changes.clear();
+    journal.clear();
+    journal_size = 0;
+    journal_cells.clear();
+    elapsed_ms = header.elapsed_ms;
+    assert(CountersMatch());
+    return true;
+}
+
+/**
+ * Flags or unflags a cell and updates the flag counters
+ * @param index flat index of an unopened cell
+ */
+template <typename Shape>
+void BasicBoard<Shape>::ToggleFlag(int index) {
+    uint8_t &cell = cells[index];
+    cell ^= CELL_FLAG;
+    int delta = (cell & CELL_FLAG) ? 1 : -1;
+    flags += delta;
+    if (cell & CELL_MINE) {
+        correct_flags += delta;
     }
 }
 
 /**
- *Get all neighbouring cell coordinates given a cell coordinate
+ * Appends the move just made to the journal, dropping any undone moves. Opens keep the cells
+ * they revealed, which are the opened cells of changes.
+ * @param index flat index of the cell acted on
+ * @param flag true for Flag, false for Open
  */
-vector<array<int, 2>> Board::GetNeighbours(int row, int col) {
-    vector<array<int, 2>> neighbours_coords;
-    int row_min, row_max, col_min, col_max;
+template <typename Shape>
+void BasicBoard<Shape>::Record(int index, bool flag, GameState state_before, int moves_before) {
+    if (!journaling) {
+        return;
+    }
+    journal_cells.resize(journal_size > 0 ? journal[journal_size - 1].end : 0);
+    journal.resize(journal_size);
+    JournalEntry entry{index, flag, state_before, game_state, moves_before, moves, (int)journal_cells.size(), 0};
+    if (!flag && game_state != LOST) {
+        journal_cells.insert(journal_cells.end(), changes.begin(), changes.end());
+    } else if (!flag) {
+        //Changes of a loss also list the unopened cells showing their answer
+        for (int n : changes) {
+            if (cells[n] & CELL_OPEN) {
+                journal_cells.push_back(n);
+            }
+        }
+    }
+    entry.end = journal_cells.size();
+    journal.push_back(entry);
+    journal_size += 1;
+}
 
-    //Set rowMin and rowMax
-    row_min = row - 1;
-    row_max = row + 1;
-    col_min = col - 1;
-    col_max = col + 1;
+/**
+ * Applies or reverts a journal entry, listing the cells that changed in changes
+ * @param forward true to redo the entry, false to undo it
+ */
+template <typename Shape>
+void BasicBoard<Shape>::Replay(const JournalEntry &entry, bool forward) {
+    changes.clear();
+    GameState from = game_state;
+    if (entry.flag) {
+        ToggleFlag(entry.index);
+        changes.push_back(entry.index);
+    }
+    int delta = forward ? 1 : -1;
+    for (int i = entry.begin; i < entry.end; i++) {
+        int n = journal_cells[i];
+        cells[n] ^= CELL_OPEN;
+        changes.push_back(n);
+        unopened -= delta;
+        if (!(cells[n] & CELL_MINE)) {
+            revealed_safe += delta;
+        }
+    }
+    game_state = forward ? entry.state_after : entry.state_before;
+    moves = forward ? entry.moves_after : entry.moves_before;
+    //Every unopened cell shows or hides its answer when the game is lost or no longer lost
+    if ((from == LOST) != (game_state == LOST)) {
+        if (!forward) {
+            changes.clear();
+        }
+        for (int i = 0; i < height * width; i++) {
+            if (!(cells[i] & CELL_OPEN)) {
+                changes.push_back(i);
+            }
+        }
+    }
+    assert(CountersMatch());
+}
 
-    if (row == 0)
-        row_min = 0;
-    else if (row == height - 1)
-        row_max = row;
+/**
+ * Populate answer grid with random bomb locations and corresponding neighbour values.
+ * Small boards draw bombs straight into the cell store and append them one by one, large
+ * boards draw into a packed mine bit matrix and compute all counts with CountNeighbourMines.
+ * Both draw the same cells for the same generator state.
+ * @param gen random generator, see BoardRng
+ * @param excluded flat indices of cells that must stay free of mines
+ */
+template <typename Shape>
+template <typename Gen>
+void BasicBoard<Shape>::PopulateAnswerGrid(Gen &gen, const vector<int> &excluded) {
+    int cell_count = height * width;
+    if (cell_count < BITBOARD_MIN_CELLS) {
+        //The mine bit of the cell store is the set of taken cells
+        vector<int> bomb_indices;
+        bomb_indices.reserve(bomb_size);
+        SampleBombs(
+            gen, excluded, [&](int index) { return (cells[index] & CELL_MINE) != 0; },
+            [&](int index, bool bomb) {
+                cells[index] = bomb ? CELL_MINE : 0;
+                if (bomb) {
+                    bomb_indices.push_back(index);
+                }
+            });
+        //Dense boards removed some of the listed bombs again
+        if ((int)bomb_indices.size() != bomb_size) {
+            bomb_indices.clear();
+            for (int i = 0; i < cell_count; i++) {
+                if (cells[i] & CELL_MINE) {
+                    bomb_indices.push_back(i);
+                }
+            }
+        }
+        AppendBomb(bomb_indices);
+        return;
+    }
 
-    if (col == 0)
-        col_min = 0;
-    else if (col == width - 1)
-        col_max = col;
+    //Rows of the mine bit matrix are padded to whole words
+    int words = (width + 63) / 64;
+    vector<uint64_t> mine_plane((size_t)height * words, 0);
+    auto locate = [&](int index, uint64_t &bit) -> uint64_t & {
+        int row = index / width;
+        int col = index - row * width;
+        bit = 1ULL << (col & 63);
+        return mine_plane[(size_t)row * words + (col >> 6)];
+    };
+    SampleBombs(
+        gen, excluded, [&](int index) {
+            uint64_t bit;
+            return (locate(index, bit) & bit) != 0;
+        },
+        [&](int index, bool bomb) {
+            uint64_t bit;
+            uint64_t &word = locate(index, bit);
+            word = bomb ? word | bit : word & ~bit;
+        });
+    CountNeighbourMines(mine_plane.data(), height, width, CELL_MINE, cells.data());
+}
 
-    //Get neighbour cells coordinates
-    for (int i = row_min; i < row_max + 1; i++) {
-        for (int j = col_min; j < col_max + 1; j++) {
-            if (i != row || j != col) {
-                neighbours_coords.push_back({i, j});
+/**
+ * Chooses bomb_size distinct bomb cells by rejection sampling, so work is proportional to the
+ * number of bombs: sparse boards draw the bomb cells, dense boards start full and draw the safe
+ * cells. Every draw succeeds with probability close to 1/2 or better.
+ * @param gen random generator, see BoardRng
+ * @param excluded flat indices of cells that never get a bomb, at most 9
+ * @param is_bomb callable returning whether the cell at a flat index currently holds a bomb
+ * @param set_bomb callable placing or removing the bomb at a flat index
+ */
+template <typename Shape>
+template <typename Gen, typename IsBomb, typename SetBomb>
+void BasicBoard<Shape>::SampleBombs(Gen &gen, const vector<int> &excluded, IsBomb is_bomb, SetBomb set_bomb) {
+    int cell_count = height * width;
+    int free_cells = cell_count - excluded.size();
+    auto is_excluded = [&](int index) {
+        return find(excluded.begin(), excluded.end(), index) != excluded.end();
+    };
+    if (bomb_size <= free_cells / 2) {
+        for (int drawn = 0; drawn < bomb_size;) {
+            int index = UniformBelow(gen, cell_count);
+            if (!is_bomb(index) && !is_excluded(index)) {
+                set_bomb(index, true);
+                drawn += 1;
             }
         }
+    } else {
+        for (int i = 0; i < cell_count; i++) {
+            if (!is_excluded(i)) {
+                set_bomb(i, true);
+            }
+        }
+        for (int safe = 0; safe < free_cells - bomb_size;) {
+            int index = UniformBelow(gen, cell_count);
+            if (is_bomb(index)) {
+                set_bomb(index, false);
+                safe += 1;
+            }
+        }
+    }
+}
+
+/**
+ * Append bombs and neighbours values into grid
+ * Increment neighbouring cells value by 1 with every bomb appended
+ * @param bomb_indices flat indices of the bombs
+ */
+template <typename Shape>
+void BasicBoard<Shape>::AppendBomb(const vector<int> &bomb_indices) {
+    for (int bomb : bomb_indices) {
+        cells[bomb] |= CELL_MINE;
+        neighbours.ForEach(bomb, [&](int n) {
+            cells[n] += 1;
+        });
+    }
+}
+
+/**
+ * Check if winning condition has been met, i.e. every safe cell is revealed
+ */
+template <typename Shape>
+void BasicBoard<Shape>::UpdateGameStatus() {
+    if (revealed_safe == height * width - bomb_size) {
+        game_state = WON;
+    }
+}
+
+/**
+ * Checks the live counters against a full scan of the cell store. Debug builds assert this after
+ * every Open, Undo, Redo and Load; tests call it directly so release builds check it too.
+ * @return true if unopened, correct_flags and revealed_safe all match the scan
+ */
+template <typename Shape>
+bool BasicBoard<Shape>::CountersMatch() {
+    int scan_unopened = 0;
+    int scan_correct_flags = 0;
+    int scan_revealed_safe = 0;
+    for (int i = 0; i < height * width; i++) {
+        if (!(cells[i] & CELL_OPEN)) {
+            scan_unopened += 1;
+        } else if (!(cells[i] & CELL_MINE)) {
+            scan_revealed_safe += 1;
+        }
+        if ((cells[i] & (CELL_FLAG | CELL_MINE)) == (CELL_FLAG | CELL_MINE)) {
+            scan_correct_flags += 1;
+        }
     }
-    return neighbours_coords;
+    return scan_unopened == unopened && scan_correct_flags == correct_flags && scan_revealed_safe == revealed_safe;
 }
 
 /**
- * Overloaded << operator to print player grid
+ * Overloaded << operator to print player grid. Does not flush, so printing many boards stays cheap.
  */
-ostream &operator<<(ostream &out, Board &board) {
+template <typename Shape>
+ostream &operator<<(ostream &out, BasicBoard<Shape> &board) {
     int width = board.GetWidth();
     int height = board.GetHeight();
-    vector<vector<int>> grid = board.GetPlayerGrid();
+    GridView grid = board.GetView();
 
     //Print column label
-    cout << "\t";
+    out << "\t";
     for (int h = 0; h < width; h++) {
-        cout << h;
+        out << h;
         if (h < 10) {
-            cout << "  ";
+            out << "  ";
         } else {
-            cout << " ";
+            out << " ";
         }
     }
-    cout << endl
-         << endl;
+    out << "\n\n";
 
     for (int i = 0; i < height; i++) {
         //Print row label
-        cout << i << "\t";
+        out << i << "\t";
         for (int j = 0; j < width; j++) {
             //Print board contents
-            cout << grid[i][j];
-            if (grid[i][j] < 10) {
-                cout << "  ";
+            out << grid.At(i, j);
+            if (grid.At(i, j) < 10) {
+                out << "  ";
             } else {
-                cout << " ";
+                out << " ";
             }
         }
-        cout << endl;
+        out << '\n';
     }
-    cout << endl;
+    out << '\n';
     return out;
 }
 
-#endif
\ No newline at end of file
+template class BasicBoard<DynamicShape>;
+template class BasicBoard<FixedShape<9, 9, 10>>;
+template class BasicBoard<FixedShape<16, 16, 40>>;
+template class BasicBoard<FixedShape<16, 30, 99>>;
+template ostream &operator<<(ostream &, BasicBoard<DynamicShape> &);
+template ostream &operator<<(ostream &, BasicBoard<FixedShape<9, 9, 10>> &);
+template ostream &operator<<(ostream &, BasicBoard<FixedShape<16, 16, 40>> &);
+template ostream &operator<<(ostream &, BasicBoard<FixedShape<16, 30, 99>> &);
@@ -0,0 +1,418 @@
+#ifndef LOGIC_H
+#define LOGIC_H
+
+#include "rng.h"
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Available difficulty levels.
+ */
+enum Level {
+    // 9x9 with 10 mines.
+    EASY,
+    // 16x16 with 40 mines.
+    NORMAL,
+    // 16x30 with 99 mines.
+    HARD,
+};
+
+/**
+ * Random generator used for mine placement. Any UniformRandomBitGenerator with 64-bit
+ * output can be plugged in here.
+ */
+using BoardRng = Xoshiro256;
+
+enum GameState {
+    //Game in progress
+    PLAYING,
+    //Bombs successfully flagged
+    WON,
+    //Bomb exploded
+    LOST
+};
+
+/**
+ * When the mines of a board are placed, relative to the first click.
+ */
+enum FirstClick {
+    //Placed at construction, the first Open may hit a mine
+    FIRST_CLICK_ANY,
+    //Placed on the first Open, never under the clicked cell
+    FIRST_CLICK_SAFE,
+    //Placed on the first Open, never under the clicked cell or its neighbours so it opens an area.
+    //Boards too dense to spare the neighbours only spare the clicked cell.
+    FIRST_CLICK_OPENING,
+};
+
+/**
+ * Border class bits of a cell, combined to index NEIGHBOUR_BORDER_MASKS
+ */
+enum Border {
+    BORDER_TOP = 1,
+    BORDER_BOTTOM = 2,
+    BORDER_LEFT = 4,
+    BORDER_RIGHT = 8,
+};
+
+/**
+ * @return mask of the neighbour offsets (ordered row-major from top left) that stay inside the
+ * grid for a cell with the given border class bits
+ */
+constexpr uint8_t BorderMask(int border) {
+    return 0xff & ~((border & BORDER_TOP ? 0x07 : 0) | (border & BORDER_BOTTOM ? 0xe0 : 0) |
+                    (border & BORDER_LEFT ? 0x29 : 0) | (border & BORDER_RIGHT ? 0x94 : 0));
+}
+
+const uint8_t NEIGHBOUR_BORDER_MASKS[16] = {
+    BorderMask(0), BorderMask(1), BorderMask(2), BorderMask(3),
+    BorderMask(4), BorderMask(5), BorderMask(6), BorderMask(7),
+    BorderMask(8), BorderMask(9), BorderMask(10), BorderMask(11),
+    BorderMask(12), BorderMask(13), BorderMask(14), BorderMask(15),
+};
+
+/**
+ * Iterates the neighbours of a cell in a row-major grid without allocating.
+ * Interior cells use a fixed table of flat index offsets, border cells filter the same table
+ * through a precomputed mask.
+ */
+class NeighbourTable {
+public:
+    NeighbourTable();
+    NeighbourTable(int, int);
+
+    template <typename F>
+    void ForEach(int, F) const;
+
+private:
+    int height;
+    int width;
+    std::array<int, 8> offsets;
+};
+
+/**
+ * Calls visit with the flat index of every neighbour of a cell, in row-major order
+ * @param index flat index of the cell
+ * @param visit callable taking an int flat index
+ */
+template <typename F>
+void NeighbourTable::ForEach(int index, F visit) const {
+    int row = index / width;
+    int col = index - row * width;
+    if (row > 0 && row < height - 1 && col > 0 && col < width - 1) {
+        for (int k = 0; k < 8; k++) {
+            visit(index + offsets[k]);
+        }
+        return;
+    }
+    int border = (row == 0 ? BORDER_TOP : 0) | (row == height - 1 ? BORDER_BOTTOM : 0) |
+                 (col == 0 ? BORDER_LEFT : 0) | (col == width - 1 ? BORDER_RIGHT : 0);
+    uint8_t mask = NEIGHBOUR_BORDER_MASKS[border];
+    for (int k = 0; k < 8; k++) {
+        if (mask & (1 << k)) {
+            visit(index + offsets[k]);
+        }
+    }
+}
+
+/**
+ * Border mask of every cell of a grid known at compile time, see BorderMask
+ */
+template <int Height, int Width>
+constexpr std::array<uint8_t, Height * Width> CellBorderMasks() {
+    std::array<uint8_t, Height * Width> masks{};
+    for (int index = 0; index < Height * Width; index++) {
+        int row = index / Width;
+        int col = index % Width;
+        masks[index] = BorderMask((row == 0 ? BORDER_TOP : 0) | (row == Height - 1 ? BORDER_BOTTOM : 0) |
+                                  (col == 0 ? BORDER_LEFT : 0) | (col == Width - 1 ? BORDER_RIGHT : 0));
+    }
+    return masks;
+}
+
+/**
+ * NeighbourTable for a grid size known at compile time. Offsets are constants and the border
+ * mask of every cell comes from a constexpr table, so ForEach is one lookup and eight unrolled
+ * tests without any division.
+ */
+template <int Height, int Width>
+class FixedNeighbourTable {
+public:
+    template <typename F>
+    void ForEach(int index, F visit) const {
+        Visit(index, visit, std::make_integer_sequence<int, 8>{});
+    }
+
+private:
+    static constexpr std::array<int, 8> OFFSETS = {-Width - 1, -Width, -Width + 1, -1, 1, Width - 1, Width, Width + 1};
+    static constexpr std::array<uint8_t, Height * Width> MASKS = CellBorderMasks<Height, Width>();
+
+    template <typename F, int... K>
+    static void Visit(int index, F &visit, std::integer_sequence<int, K...>) {
+        uint8_t mask = MASKS[index];
+        auto step = [&](int k) {
+            if (mask & (1 << k)) {
+                visit(index + OFFSETS[k]);
+            }
+        };
+        (step(K), ...);
+    }
+};
+
+/**
+ * Size of a board known at run time, used by Board for the presets and custom boards
+ */
+struct DynamicShape {
+    using Cells = std::vector<uint8_t>;
+    using Neighbours = NeighbourTable;
+
+    //Easy mode unless set
+    int height = 9;
+    int width = 9;
+    int bomb_size = 10;
+
+    static DynamicShape Preset(Level);
+    static DynamicShape Custom(uint16_t, uint16_t, uint32_t);
+    bool Resize(int, int, int);
+
+    void Allocate(Cells &cells) const {
+        cells.assign(height * width, 0);
+    }
+    Neighbours MakeNeighbours() const {
+        return NeighbourTable{height, width};
+    }
+};
+
+/**
+ * Size of a board known at compile time, with fixed-size cell storage
+ */
+template <int Height, int Width, int Mines>
+struct FixedShape {
+    static_assert(Height > 0 && Width > 0 && Mines > 0 && Mines < Height * Width, "invalid board size");
+
+    using Cells = std::array<uint8_t, Height * Width>;
+    using Neighbours = FixedNeighbourTable<Height, Width>;
+
+    static constexpr int height = Height;
+    static constexpr int width = Width;
+    static constexpr int bomb_size = Mines;
+
+    static bool Resize(int h, int w, int m) {
+        return h == Height && w == Width && m == Mines;
+    }
+    static void Allocate(Cells &cells) {
+        cells.fill(0);
+    }
+    static Neighbours MakeNeighbours() {
+        return {};
+    }
+};
+
+class GridView;
+
+/**
+ * Game logic over a board shape, either DynamicShape (see Board) or a FixedShape whose
+ * dimensions are compile-time constants (see EasyBoard, NormalBoard, HardBoard). All shapes
+ * share this interface and give the same layout for the same seed.
+ */
+template <typename Shape>
+class BasicBoard : private Shape {
+public:
+    /**
+     * Bit layout of a cell in the cell store.
+     * Low nibble holds the number of neighbouring mines (0-8), the remaining bits are
+     * independent mine/open/flag planes.
+     */
+    enum CellBits : uint8_t {
+        CELL_COUNT = 0x0f,
+        CELL_MINE = 0x10,
+        CELL_OPEN = 0x20,
+        CELL_FLAG = 0x40,
+    };
+
+    //Constructors
+    BasicBoard(uint64_t seed = RandomSeed(), FirstClick first_click = FIRST_CLICK_ANY);
+    BasicBoard(const Shape &, uint64_t seed = RandomSeed(), FirstClick first_click = FIRST_CLICK_ANY);
+
+    //Getters
+    std::vector<std::vector<int>> GetPlayerGrid();
+    // std::vector<std::vector<int>> GetAnswerGrid();
+    std::vector<std::array<int, 2>> GetWrongFlags();
+    int GetHeight();
+    int GetWidth();
+    int GetMoves();
+    int GetFlagsLeft();
+    uint64_t GetSeed();
+    FirstClick GetFirstClick();
+    GameState GetState();
+    GridView GetView();
+    const std::vector<int> &GetChanges();
+    bool CountersMatch();
+
+    //Setters?
+    void Flag(int, int);
+    GameState Open(int, int);
+    bool Undo();
+    bool Redo();
+    void EnableJournal();
+
+    //Saved games
+    bool Save(const std::string &, uint32_t elapsed_ms = 0);
+    void Save(std::vector<uint8_t> &, uint32_t elapsed_ms = 0);
+    bool Load(const std::string &, uint32_t &elapsed_ms);
+    bool Load(const uint8_t *, size_t, uint32_t &elapsed_ms);
+
+    //Largest number of cells a board may hold, keeps flat indices within int
+    const static int MAX_CELLS = 1 << 28;
+    //Boards from this many cells count neighbours with the bitboard kernel
+    const static int BITBOARD_MIN_CELLS = 1 << 12;
+
+private:
+    /**
+     * A move in the journal. Opens keep the cells they revealed as a range of journal_cells,
+     * so undoing or redoing one costs as much as the cells it revealed.
+     */
+    struct JournalEntry {
+        //Flat index of the cell acted on
+        int index;
+        //True for Flag, false for Open
+        bool flag;
+        GameState state_before;
+        GameState state_after;
+        int moves_before;
+        int moves_after;
+        //Range of journal_cells revealed by an Open
+        int begin;
+        int end;
+    };
+
+    //Members
+    using Shape::bomb_size;
+    using Shape::height;
+    using Shape::width;
+    uint64_t seed;
+    FirstClick first_click;
+    //False until the mines are placed, see FirstClick
+    bool placed = false;
+    int moves = 0;
+    int flags = 0;
+    //Live counters kept up to date by Open and Flag
+    int unopened = 0;
+    int correct_flags = 0;
+    int revealed_safe = 0;
+    GameState game_state = PLAYING;
+    //Row-major cell store, one byte per cell
+    typename Shape::Cells cells;
+    //Flat indices of cells whose visible state changed in the last move
+    std::vector<int> changes;
+    //Work stack of the flood fill, kept to reuse its capacity
+    std::vector<int> reveal_stack;
+    typename Shape::Neighbours neighbours;
+    //Moves that changed the board in play order, the ones from journal_size on were undone.
+    //Only kept once EnableJournal is called.
+    bool journaling = false;
+    std::vector<JournalEntry> journal;
+    size_t journal_size = 0;
+    //Flat indices revealed by the Opens of the journal, in reveal order
+    std::vector<int> journal_cells;
+
+    //Functions
+    void Initialise();
+    void PlaceMines(int first);
+    int Reveal(int index);
+    void ToggleFlag(int index);
+    void Record(int index, bool flag, GameState state_before, int moves_before);
+    void Replay(const JournalEntry &entry, bool forward);
+    template <typename Gen>
+    void PopulateAnswerGrid(Gen &gen, const std::vector<int> &excluded);
+    template <typename Gen, typename IsBomb, typename SetBomb>
+    void SampleBombs(Gen &gen, const std::vector<int> &excluded, IsBomb is_bomb, SetBomb set_bomb);
+    void AppendBomb(const std::vector<int> &bomb_indices);
+    void UpdateGameStatus();
+};
+
+/**
+ * Board of any size, chosen at run time
+ */
+class Board : public BasicBoard<DynamicShape> {
+public:
+    Board(Level, uint64_t seed = RandomSeed(), FirstClick first_click = FIRST_CLICK_ANY);
+    Board(uint16_t, uint16_t, uint32_t, uint64_t seed = RandomSeed(), FirstClick first_click = FIRST_CLICK_ANY);
+};
+
+//Preset boards with compile-time dimensions, same layouts as Board for the same seed
+using EasyBoard = BasicBoard<FixedShape<9, 9, 10>>;
+using NormalBoard = BasicBoard<FixedShape<16, 16, 40>>;
+using HardBoard = BasicBoard<FixedShape<16, 30, 99>>;
+
+/**
+ * Read-only view of the player grid over a board's cell store. Copying it is free,
+ * it stays valid for as long as the board it came from.
+ */
+class GridView {
+public:
+    GridView(const uint8_t *, int, int, const GameState *);
+
+    int GetHeight() const;
+    int GetWidth() const;
+    int At(int, int) const;
+    int At(int) const;
+    const uint8_t *Data() const;
+
+private:
+    const uint8_t *cells;
+    int height;
+    int width;
+    const GameState *game_state;
+};
+
+/**
+ * Creates a view over a cell store
+ * @param cells row-major cell store
+ * @param height the height of grid
+ * @param width the width of grid
+ * @param game_state state of the game owning the cells, the answer grid is shown once lost
+ */
+inline GridView::GridView(const uint8_t *cells, int height, int width, const GameState *game_state) : cells{cells}, height{height}, width{width}, game_state{game_state} {}
+
+inline int GridView::GetHeight() const {
+    return height;
+}
+inline int GridView::GetWidth() const {
+    return width;
+}
+
+/**
+ * @return value of cell (row, col) as seen by the player, same values as GetPlayerGrid
+ */
+inline int GridView::At(int row, int col) const {
+    return At(row * width + col);
+}
+
+/**
+ * @return value of cell at flat index as seen by the player: 0-8 for an opened cell, 9 for a bomb,
+ * 10 if unopened and 11 if flagged. Once the game is lost the whole answer grid is shown.
+ */
+inline int GridView::At(int index) const {
+    uint8_t cell = cells[index];
+    if (*game_state == LOST || (cell & Board::CELL_OPEN)) {
+        return (cell & Board::CELL_MINE) ? 9 : (cell & Board::CELL_COUNT);
+    }
+    return (cell & Board::CELL_FLAG) ? 11 : 10;
+}
+
+/**
+ * @return raw row-major cell store, see Board::CellBits for the layout
+ */
+inline const uint8_t *GridView::Data() const {
+    return cells;
+}
+
+template <typename Shape>
+std::ostream &operator<<(std::ostream &, BasicBoard<Shape> &);
+
+#endif
@@ -2,16 +2,28 @@
 #include "gamescene.cpp"
 #include "menuscene.cpp"
 #include "scene.cpp"
-#include <SDL2\SDL.h>
-#include <SDL2\SDL_image.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
 #include <iostream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 //To change: Each scene should have a settable height and width.
 const int DEFAULT_WINDOW_WIDTH = 600;
 const int DEFAULT_WINDOW_HEIGHT = 600;
 
 // Function declarations
-bool Init();
+bool Init(int, char *[]);
+bool IsInput(const SDL_Event &);
+Uint32 Percentile(std::vector<Uint32> &, int);
+double ProcessCpuSeconds();
 void Quit();
 void Testing();
 
@@ -19,6 +31,7 @@ void Testing();
 SDL_Window *window;     //Application Window
 SDL_Renderer *renderer; //Window Renderer
 TTF_Font *font;         //Font
+GlyphAtlas text;        //Glyphs of font, drawn by all scenes
 
 // Scene variables
 Scene *SceneManager::curr_scene = NULL;
@@ -27,9 +40,11 @@ Scene *SceneManager::all_scene[Scene::SCENE_TOTAL];
 // Scene *scenes[Scene::SCENE_TOTAL];
 /**
  * Initialise SDL subsystems and global variables.
+ * @param argc number of command line arguments
+ * @param args command line arguments, "--custom HEIGHT WIDTH MINES" starts a custom game instead of the menu
  * @return true on success, or false on error
  */
-bool Init() {
+bool Init(int argc, char *args[]) {
     // Init SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "SDL cannot be initialised!" << std::endl
@@ -68,13 +83,23 @@ bool Init() {
                   << TTF_GetError();
         return false;
     }
+    if (!text.Load(font, renderer)) {
+        std::cerr << "Glyph atlas creation failed!" << std::endl;
+        return false;
+    }
     //Initialise all_scene pointers to NULL
     for (int i = 0; i < Scene::SCENE_TOTAL; i++) {
         SceneManager::all_scene[i] = NULL;
     }
     //Create menu and set as current scene
-    MenuScene *temp = new MenuScene{window, font};
+    MenuScene *temp = new MenuScene{window, &text};
     SceneManager::SetAndTransition(Scene::SCENE_MENU, temp);
+    for (int i = 1; i + 3 < argc; i++) {
+        if (std::string(args[i]) == "--custom") {
+            GameScene *game = new GameScene{window, (uint16_t)atoi(args[i + 1]), (uint16_t)atoi(args[i + 2]), (uint32_t)atoi(args[i + 3]), &text};
+            SceneManager::SetAndTransition(Scene::SCENE_GAME, game);
+        }
+    }
 
     return true;
 }
@@ -84,9 +109,10 @@ bool Init() {
  */
 void Quit() {
     //Destroy
-    SDL_DestroyWindow(window);
-    SDL_DestroyRenderer(renderer);
     SceneManager::Free();
+    text.Free();
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
 
     //Deallocate
     renderer = NULL;
@@ -101,28 +127,169 @@ void Quit() {
     SDL_Quit();
 }
 
+/**
+ * @return true for keyboard and mouse events
+ */
+bool IsInput(const SDL_Event &e) {
+    switch (e.type) {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    case SDL_MOUSEMOTION:
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+    case SDL_MOUSEWHEEL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @param samples values, reordered
+ * @param percent percentile to find, 0 to 100
+ * @return nearest-rank percentile of samples, or 0 if empty
+ */
+Uint32 Percentile(std::vector<Uint32> &samples, int percent) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t rank = (samples.size() * percent + 99) / 100;
+    auto nth = samples.begin() + (rank ? rank - 1 : 0);
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+/**
+ * @return CPU time used by this process so far, in seconds, over all threads
+ */
+double ProcessCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    //FILETIMEs count 100 ns intervals
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 1e7;
+#else
+    timespec cpu;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu) != 0) {
+        return 0;
+    }
+    return cpu.tv_sec + cpu.tv_nsec / 1e9;
+#endif
+}
+
 int main(int argc, char *args[]) {
     // Initialisation of SDL
-    if (!Init()) {
+    if (!Init(argc, args)) {
         std::cerr << "Failed to initialise!" << std::endl;
     } else {
+        //--stats prints the average and worst time to handle input and render a frame (present
+        //excluded, it waits for VSYNC), the draw calls per frame and the CPU usage, once a second.
+        //--fps caps frames per second when the renderer has no VSYNC.
+        bool stats = false;
+        int fps = 60;
+        for (int i = 1; i < argc; i++) {
+            stats = stats || std::string(args[i]) == "--stats";
+            if (std::string(args[i]) == "--fps" && i + 1 < argc) {
+                fps = std::max(1, atoi(args[++i]));
+            }
+        }
+        SDL_RendererInfo info;
+        const bool vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+        const Uint32 frame_interval = vsync ? 0 : 1000 / fps;
+        Uint32 last_present = SDL_GetTicks() - frame_interval;
+        const double ticks_per_ms = SDL_GetPerformanceFrequency() / 1000.0;
+        Uint64 frame_ticks = 0;
+        Uint64 max_frame_ticks = 0;
+        Uint32 frames = 0;
+        Uint32 stats_start = SDL_GetTicks();
+        Texture::draw_calls = 0;
+
+        double stats_cpu = ProcessCpuSeconds();
+        //Queue times of input not yet presented, and input to present latencies in ms
+        std::vector<Uint32> pending_input;
+        std::vector<Uint32> latency;
+        std::vector<Uint32> all_latency;
+
         bool running = true;
         SDL_Event e;
         while (running) {
-            while (SDL_PollEvent(&e) != 0) {
+            //Sleep until an event arrives or the scene needs drawing: now if dirty (but not before the
+            //next frame when capped), when it next changes on its own (e.g. the timer), or never
+            Sint32 timeout = SceneManager::curr_scene->GetRedrawDelay();
+            if (SceneManager::curr_scene->IsDirty()) {
+                Uint32 since = SDL_GetTicks() - last_present;
+                timeout = since < frame_interval ? frame_interval - since : 0;
+            }
+            if (stats && (timeout < 0 || timeout > 1000)) {
+                timeout = 1000;
+            }
+            bool has_event = timeout == 0 ? SDL_PollEvent(&e) : SDL_WaitEventTimeout(&e, timeout);
+
+            //Dispatch every queued event in order, remembering when input that changed the scene
+            //was queued to time it until it is on screen
+            Uint64 frame_start = SDL_GetPerformanceCounter();
+            while (has_event) {
                 if (e.type == SDL_QUIT) {
                     running = false;
                     break;
                 }
+                if (e.type == SDL_WINDOWEVENT) {
+                    SceneManager::curr_scene->SetDirty(true);
+                }
+                //Textures are lost with the device, rasterise the glyphs again
+                if (e.type == SDL_RENDER_DEVICE_RESET && !text.Load(font, renderer)) {
+                    std::cerr << "Glyph atlas creation failed!" << std::endl;
+                }
+                SceneManager::curr_scene->HandleEvent(&e);
+                if (stats && IsInput(e) && SceneManager::curr_scene->IsDirty()) {
+                    pending_input.push_back(e.common.timestamp);
+                }
+                has_event = SDL_PollEvent(&e);
+            }
+            if (SceneManager::curr_scene->IsDirty() && SDL_GetTicks() - last_present >= frame_interval) {
+                //Clear Screen
+                SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
+                SDL_RenderClear(renderer);
+                SceneManager::curr_scene->Render();
+                SceneManager::curr_scene->SetDirty(false);
+                Uint64 frame = SDL_GetPerformanceCounter() - frame_start;
+                //Render to window
+                SDL_RenderPresent(renderer);
+                last_present = SDL_GetTicks();
+                for (Uint32 timestamp : pending_input) {
+                    latency.push_back(last_present - timestamp);
+                    all_latency.push_back(last_present - timestamp);
+                }
+                pending_input.clear();
+
+                frame_ticks += frame;
+                max_frame_ticks = std::max(max_frame_ticks, frame);
+                frames++;
+            }
+
+            if (stats && SDL_GetTicks() - stats_start >= 1000) {
+                const double cpu = ProcessCpuSeconds();
+                const double cpu_percent = 100.0 * (cpu - stats_cpu) / ((SDL_GetTicks() - stats_start) / 1000.0);
+                printf("%u frames, frame %.3f ms (max %.3f ms), %.1f draw calls/frame, cpu %.1f%%, input to present p50 %u ms p99 %u ms (%zu inputs)\n", frames, frames ? frame_ticks / ticks_per_ms / frames : 0.0, max_frame_ticks / ticks_per_ms, frames ? (double)Texture::draw_calls / frames : 0.0, cpu_percent, Percentile(latency, 50), Percentile(latency, 99), latency.size());
+                latency.clear();
+                frame_ticks = 0;
+                max_frame_ticks = 0;
+                frames = 0;
+                stats_start = SDL_GetTicks();
+                stats_cpu = cpu;
+                Texture::draw_calls = 0;
             }
-            //Clear Screen
-            SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
-            SDL_RenderClear(renderer);
-            //Things happen here
-            SceneManager::curr_scene->HandleEvent(&e);
-            SceneManager::curr_scene->Render();
-            //Render to window
-            SDL_RenderPresent(renderer);
+        }
+
+        if (stats && !all_latency.empty()) {
+            printf("input to present over %zu inputs: p50 %u ms, p99 %u ms\n", all_latency.size(), Percentile(all_latency, 50), Percentile(all_latency, 99));
         }
 
         // Testing();
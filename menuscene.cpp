@@ -21,7 +21,7 @@ public:
         KEY_MOUSE_TOTAL
     };
 
-    MenuScene(SDL_Window *, TTF_Font *);
+    MenuScene(SDL_Window *, GlyphAtlas *);
     void Render();
     void Free();
     void HandleEvent(SDL_Event *);
@@ -46,23 +46,23 @@ SDL_Color MenuScene::default_text_color = SDL_Color{0, 0, 0, 255};
 /**
  * Creates a menu
  * @param window SDL_Window pointer to load scene
- * @param font Font used to render text
+ * @param text Text renderer
  */
-MenuScene::MenuScene(SDL_Window *window, TTF_Font *font) : Scene(window, font) {
+MenuScene::MenuScene(SDL_Window *window, GlyphAtlas *text) : Scene(window, text) {
     g_renderer = SDL_GetRenderer(window);
     SetWindowSize(400, 400);
 
-    easy = new Button{g_font, g_renderer, "Easy", 150, 150};
-    normal = new Button{g_font, g_renderer, "Normal", 150, 180};
-    hard = new Button{g_font, g_renderer, "Hard", 150, 210};
-    custom = new Button{g_font, g_renderer, "Custom", 150, 240};
+    easy = new Button{g_text, g_renderer, "Easy", 150, 150};
+    normal = new Button{g_text, g_renderer, "Normal", 150, 180};
+    hard = new Button{g_text, g_renderer, "Hard", 150, 210};
+    custom = new Button{g_text, g_renderer, "Custom", 150, 240};
     button_list.push_back(easy);
     button_list.push_back(normal);
     button_list.push_back(hard);
     button_list.push_back(custom);
     for (auto button : button_list) {
-        button->SetTexture(Button::MOUSE_OUT, &default_text_color);
-        button->SetTexture(Button::MOUSE_IN, &over_text_color);
+        button->SetColor(Button::MOUSE_OUT, default_text_color);
+        button->SetColor(Button::MOUSE_IN, over_text_color);
     }
 }
 
@@ -87,17 +87,21 @@ void MenuScene::Free() {
  * Checks if buttons were pressed and transitions if necessary
  */
 void MenuScene::HandleEvent(SDL_Event *e) {
+    //Buttons are highlighted under the mouse
+    if (e->type == SDL_MOUSEMOTION) {
+        dirty = true;
+    }
     if (e->type == SDL_MOUSEBUTTONUP || e->type == SDL_MOUSEBUTTONDOWN) {
         GameScene *game = NULL;
         if (easy->HandleEvent(e)) {
-            game = new GameScene{g_window, Level::EASY, g_font};
+            game = new GameScene{g_window, Level::EASY, g_text};
         } else if (normal->HandleEvent(e)) {
-            game = new GameScene{g_window, Level::NORMAL, g_font};
+            game = new GameScene{g_window, Level::NORMAL, g_text};
         } else if (hard->HandleEvent(e)) {
-            game = new GameScene{g_window, Level::HARD, g_font};
+            game = new GameScene{g_window, Level::HARD, g_text};
         }
         if (game != NULL) {
-            cerr << "Transition to game" << endl;
+            std::cerr << "Transition to game" << std::endl;
             SceneManager::SetAndTransition(Scene::SCENE_GAME, game);
         }
     }
@@ -0,0 +1,128 @@
+#include "noguess.h"
+#include "player.h"
+#include <algorithm>
+using namespace std;
+
+/**
+ * Lowers an atomic to value if value is smaller
+ */
+static void AtomicMin(atomic<uint64_t> &target, uint64_t value) {
+    uint64_t current = target.load();
+    while (value < current && !target.compare_exchange_weak(current, value)) {
+    }
+}
+
+/**
+ * Starts the worker pool
+ * @param threads number of worker threads, at least one is started
+ */
+NoGuessGenerator::NoGuessGenerator(int threads) {
+    for (int t = 0; t < max(threads, 1); t++) {
+        workers.emplace_back(&NoGuessGenerator::Work, this);
+    }
+}
+
+NoGuessGenerator::~NoGuessGenerator() {
+    {
+        lock_guard<std::mutex> lock(job_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Searches for a board solvable from a first click by deduction alone
+ * @param height the height of grid
+ * @param width the width of grid
+ * @param mines the number of bombs, invalid sizes fall back to easy mode as in Board
+ * @param row row of the first click
+ * @param col column of the first click
+ * @param seed base seed of the candidates
+ * @param budget_ms time budget in milliseconds. When it runs out the lowest candidate with a
+ * safe first click found so far is returned, or candidate 0 if there is none.
+ * @param first_click mine placement of the boards, the first click is always safe unless
+ * FIRST_CLICK_ANY
+ * @return seed of the board and whether it is guaranteed guess-free
+ */
+NoGuessResult NoGuessGenerator::Generate(uint16_t height, uint16_t width, uint32_t mines, int row, int col, uint64_t seed, int budget_ms, FirstClick first_click) {
+    //Validate the size as Board does, so the search runs on what would really be played
+    const DynamicShape shape = DynamicShape::Custom(height, width, mines);
+    unique_lock<std::mutex> lock(job_mutex);
+    this->height = shape.height;
+    this->width = shape.width;
+    this->mines = shape.bomb_size;
+    start = min(max(row, 0), shape.height - 1) * shape.width + min(max(col, 0), shape.width - 1);
+    this->seed = seed;
+    this->first_click = first_click;
+    deadline = Clock::now() + chrono::milliseconds(budget_ms);
+    next_candidate = 0;
+    generated = 0;
+    found = UINT64_MAX;
+    fallback = UINT64_MAX;
+    active = workers.size();
+    job += 1;
+    wake.notify_all();
+    done.wait(lock, [&] {
+        return active == 0;
+    });
+
+    NoGuessResult result;
+    result.no_guess = found != UINT64_MAX;
+    result.seed = StreamSeed(seed, result.no_guess ? found.load() : fallback != UINT64_MAX ? fallback.load() : 0);
+    result.candidates = generated;
+    return result;
+}
+
+/**
+ * Worker loop, runs Search once per job
+ */
+void NoGuessGenerator::Work() {
+    uint64_t seen = 0;
+    unique_lock<std::mutex> lock(job_mutex);
+    while (true) {
+        wake.wait(lock, [&] {
+            return stopping || job != seen;
+        });
+        if (stopping) {
+            return;
+        }
+        seen = job;
+        lock.unlock();
+        Search();
+        lock.lock();
+        active -= 1;
+        if (active == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+/**
+ * Claims and checks candidates until a lower one is valid or the deadline passes
+ */
+void NoGuessGenerator::Search() {
+    Player player;
+    while (true) {
+        uint64_t candidate = next_candidate.fetch_add(1);
+        //Cancelled by a lower valid candidate
+        if (candidate >= found.load()) {
+            return;
+        }
+        if (found.load() == UINT64_MAX && Clock::now() > deadline) {
+            return;
+        }
+        Board board(height, width, mines, StreamSeed(seed, candidate), first_click);
+        generated += 1;
+        //Deferred placement has no mines yet and spares the first click anyway
+        if (board.GetView().Data()[start] & Board::CELL_MINE) {
+            continue;
+        }
+        AtomicMin(fallback, candidate);
+        if (board.Open(start / width, start % width) == WON || player.Play(board, false) == WON) {
+            AtomicMin(found, candidate);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef NOGUESS_H
+#define NOGUESS_H
+
+#include "logic.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Outcome of a no-guess search
+ */
+struct NoGuessResult {
+    //Seed of the board, construct it with the dimensions that were searched
+    uint64_t seed;
+    //False if the time budget ran out and the board may need a guess
+    bool no_guess;
+    //Candidate layouts generated
+    uint64_t candidates;
+};
+
+/**
+ * Finds boards that the Solver clears from a given first click without a single guess.
+ * Candidate i is the ordinary board seeded with StreamSeed(seed, i) and placing its mines as
+ * set by FirstClick. A pool of worker threads
+ * claims candidates in index order, and the lowest valid index wins: once one is found, higher
+ * candidates are skipped, lower ones still in progress are finished. The result therefore does
+ * not depend on the number of threads, unless the time budget runs out first.
+ */
+class NoGuessGenerator {
+public:
+    NoGuessGenerator(int threads = std::thread::hardware_concurrency());
+    ~NoGuessGenerator();
+
+    NoGuessResult Generate(uint16_t height, uint16_t width, uint32_t mines, int row, int col, uint64_t seed, int budget_ms, FirstClick first_click = FIRST_CLICK_ANY);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::thread> workers;
+    std::mutex job_mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping = false;
+    //Incremented for every job, workers compare it to the last job they worked on
+    uint64_t job = 0;
+    int active = 0;
+
+    //Current job, written before the workers are woken
+    uint16_t height;
+    uint16_t width;
+    uint32_t mines;
+    int start;
+    uint64_t seed;
+    FirstClick first_click;
+    Clock::time_point deadline;
+    std::atomic<uint64_t> next_candidate;
+    std::atomic<uint64_t> generated;
+    //Lowest valid candidate, and lowest candidate with a safe first click as fallback
+    std::atomic<uint64_t> found;
+    std::atomic<uint64_t> fallback;
+
+    void Work();
+    void Search();
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "player.h"
+#include "solver.h"
+using namespace std;
+
+/**
+ * Plays a board from its current position
+ * @param board board in progress, may already have opened cells
+ * @param guess false to stop when no cell is certainly safe
+ * @return WON or LOST, or PLAYING if stopped before a guess
+ */
+template <typename B>
+GameState Player::Play(B &board, bool guess) {
+    GridView view = board.GetView();
+    int width = board.GetWidth();
+    int cells = board.GetHeight() * width;
+    Solver solver{view};
+    size_t next = 0;
+    GameState state = PLAYING;
+    guesses = 0;
+    while (state == PLAYING) {
+        solver.Solve();
+        const vector<int> &safe = solver.GetSafe();
+        if (next < safe.size()) {
+            for (; next < safe.size() && state == PLAYING; next++) {
+                if (view.At(safe[next]) == 10) {
+                    state = board.Open(safe[next] / width, safe[next] % width);
+                    solver.Update(board.GetChanges());
+                }
+            }
+            continue;
+        }
+        if (!guess) {
+            break;
+        }
+        //Probabilities only fail on wrong flags, then any unopened cell will do
+        bool known = engine.Compute(view, board.GetFlagsLeft());
+        const vector<double> &probabilities = engine.GetProbabilities();
+        int target = -1;
+        for (int i = 0; i < cells; i++) {
+            if (view.At(i) == 10 && (target < 0 || (known && probabilities[i] < probabilities[target]))) {
+                target = i;
+            }
+        }
+        if (target < 0) {
+            break;
+        }
+        guesses += 1;
+        state = board.Open(target / width, target % width);
+        solver.Update(board.GetChanges());
+    }
+    return state;
+}
+
+template GameState Player::Play(Board &, bool);
+template GameState Player::Play(EasyBoard &, bool);
+template GameState Player::Play(NormalBoard &, bool);
+template GameState Player::Play(HardBoard &, bool);
+
+/**
+ * @return guesses made in the last game
+ */
+int Player::GetGuesses() const {
+    return guesses;
+}
@@ -0,0 +1,24 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include "logic.h"
+#include "probability.h"
+
+/**
+ * Built-in policy for automated play: opens every cell the Solver proves safe and, when nothing
+ * is certain, guesses the unopened cell with the lowest mine probability (the first one on ties).
+ * Deterministic, the same board always plays out the same way.
+ * Play is instantiated for Board and the fixed preset boards.
+ */
+class Player {
+public:
+    template <typename B>
+    GameState Play(B &, bool guess = true);
+    int GetGuesses() const;
+
+private:
+    ProbabilityEngine engine;
+    int guesses = 0;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "probability.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+/**
+ * Binomial coefficients up to 8, a group never holds more cells than one number has neighbours
+ */
+struct ChooseTable {
+    double entry[9][9] = {};
+
+    ChooseTable() {
+        for (int n = 0; n <= 8; n++) {
+            entry[n][0] = 1;
+            for (int k = 1; k <= n; k++) {
+                entry[n][k] = entry[n - 1][k - 1] + (k < n ? entry[n - 1][k] : 0);
+            }
+        }
+    }
+};
+
+static const ChooseTable CHOOSE;
+
+/**
+ * @return log of n choose k
+ */
+static double LogChoose(int n, int k) {
+    return lgamma(n + 1.0) - lgamma(k + 1.0) - lgamma(n - k + 1.0);
+}
+
+/**
+ * @return convolution of two distributions indexed by number of mines
+ */
+static vector<double> Convolve(const vector<double> &a, const vector<double> &b) {
+    vector<double> result(a.size() + b.size() - 1, 0.0);
+    for (size_t i = 0; i < a.size(); i++) {
+        for (size_t j = 0; j < b.size(); j++) {
+            result[i + j] += a[i] * b[j];
+        }
+    }
+    return result;
+}
+
+/**
+ * Computes the mine probability of every cell
+ * @param view player grid
+ * @param mines_left mines not flagged yet, see Board::GetFlagsLeft
+ * @return false if no mine layout agrees with the grid, e.g. because of a wrong flag
+ */
+bool ProbabilityEngine::Compute(GridView view, int mines_left) {
+    int cells = view.GetHeight() * view.GetWidth();
+    probabilities.assign(cells, 0.0);
+    vector<int> interior;
+    if (mines_left < 0 || !BuildGroups(view, interior)) {
+        return false;
+    }
+    BuildComponents();
+
+    constraint_mines.assign(constraint_target.size(), 0);
+    constraint_free.assign(constraint_target.size(), 0);
+    for (size_t g = 0; g < group_cells.size(); g++) {
+        for (int c : group_constraints[g]) {
+            constraint_free[c] += group_cells[g].size();
+        }
+    }
+    group_mines.assign(group_cells.size(), 0);
+    mine_limit = mines_left;
+
+    //Enumerate each component on its own
+    vector<vector<double>> counts(components.size());
+    vector<vector<vector<double>>> expected_mines(components.size());
+    for (size_t i = 0; i < components.size(); i++) {
+        int size = 0;
+        for (int g : components[i]) {
+            size += group_cells[g].size();
+        }
+        int max_mines = min(size, mines_left);
+        solutions.assign(max_mines + 1, 0.0);
+        solution_group_mines.assign(max_mines + 1, vector<double>(components[i].size(), 0.0));
+        Enumerate(components[i], 0, 0, 1.0);
+        if (*max_element(solutions.begin(), solutions.end()) == 0) {
+            return false;
+        }
+        counts[i].swap(solutions);
+        expected_mines[i].swap(solution_group_mines);
+    }
+
+    //Weight each total of frontier mines by the ways to place the rest in the interior
+    vector<double> total{1.0};
+    for (const vector<double> &count : counts) {
+        total = Convolve(total, count);
+    }
+    int interior_size = interior.size();
+    vector<double> weight(total.size(), 0.0);
+    double max_log = -HUGE_VAL;
+    for (int k = 0; k < (int)total.size(); k++) {
+        int rest = mines_left - k;
+        if (total[k] > 0 && rest >= 0 && rest <= interior_size) {
+            max_log = max(max_log, LogChoose(interior_size, rest));
+        }
+    }
+    double sum = 0;
+    double interior_mines = 0;
+    for (int k = 0; k < (int)total.size(); k++) {
+        int rest = mines_left - k;
+        if (total[k] > 0 && rest >= 0 && rest <= interior_size) {
+            weight[k] = exp(LogChoose(interior_size, rest) - max_log);
+            sum += total[k] * weight[k];
+            interior_mines += total[k] * weight[k] * rest;
+        }
+    }
+    if (sum == 0) {
+        return false;
+    }
+    for (int index : interior) {
+        probabilities[index] = interior_mines / sum / interior_size;
+    }
+
+    //A group's expected mines sum over its component's totals, weighted by all other components
+    for (size_t i = 0; i < components.size(); i++) {
+        vector<double> others{1.0};
+        for (size_t j = 0; j < components.size(); j++) {
+            if (j != i) {
+                others = Convolve(others, counts[j]);
+            }
+        }
+        vector<double> expected(components[i].size(), 0.0);
+        for (size_t k = 0; k < counts[i].size(); k++) {
+            double ways = 0;
+            for (size_t r = 0; r < others.size() && k + r < weight.size(); r++) {
+                ways += others[r] * weight[k + r];
+            }
+            for (size_t p = 0; p < expected.size(); p++) {
+                expected[p] += expected_mines[i][k][p] * ways;
+            }
+        }
+        for (size_t p = 0; p < expected.size(); p++) {
+            const vector<int> &group = group_cells[components[i][p]];
+            for (int index : group) {
+                probabilities[index] = expected[p] / sum / group.size();
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @return mine probability per flat index: 0 for opened cells and 1 for flagged cells
+ */
+const vector<double> &ProbabilityEngine::GetProbabilities() const {
+    return probabilities;
+}
+
+/**
+ * @return number of independent frontier components in the last computed grid
+ */
+int ProbabilityEngine::GetComponentCount() const {
+    return components.size();
+}
+
+/**
+ * Turns opened numbers into constraints and groups the frontier cells by the numbers they touch
+ * @param view player grid
+ * @param interior receives the unopened cells that touch no number
+ * @return false if a number can not be satisfied
+ */
+bool ProbabilityEngine::BuildGroups(GridView view, vector<int> &interior) {
+    int cells = view.GetHeight() * view.GetWidth();
+    NeighbourTable neighbours{view.GetHeight(), view.GetWidth()};
+    constraint_of.assign(cells, -1);
+    constraint_target.clear();
+    for (int i = 0; i < cells; i++) {
+        int value = view.At(i);
+        if (value == 11) {
+            probabilities[i] = 1;
+        }
+        if (value > 8) {
+            continue;
+        }
+        int unknown = 0;
+        int flagged = 0;
+        neighbours.ForEach(i, [&](int n) {
+            int neighbour = view.At(n);
+            unknown += neighbour == 10;
+            flagged += neighbour == 11;
+        });
+        int target = value - flagged;
+        if (target < 0 || target > unknown) {
+            return false;
+        }
+        if (unknown > 0) {
+            constraint_of[i] = constraint_target.size();
+            constraint_target.push_back(target);
+        }
+    }
+
+    //Constraint ids grow with the flat index and neighbours are visited in index order,
+    //so each key is sorted and equal keys mean the same set of numbers
+    vector<pair<array<int, 8>, int>> keyed;
+    for (int i = 0; i < cells; i++) {
+        if (view.At(i) != 10) {
+            continue;
+        }
+        array<int, 8> key;
+        key.fill(-1);
+        int k = 0;
+        neighbours.ForEach(i, [&](int n) {
+            if (constraint_of[n] >= 0) {
+                key[k++] = constraint_of[n];
+            }
+        });
+        if (k == 0) {
+            interior.push_back(i);
+        } else {
+            keyed.push_back({key, i});
+        }
+    }
+    sort(keyed.begin(), keyed.end());
+
+    group_cells.clear();
+    group_constraints.clear();
+    constraint_groups.assign(constraint_target.size(), {});
+    for (size_t i = 0; i < keyed.size(); i++) {
+        if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+            int group = group_cells.size();
+            group_cells.push_back({});
+            group_constraints.push_back({});
+            for (int c : keyed[i].first) {
+                if (c >= 0) {
+                    group_constraints[group].push_back(c);
+                    constraint_groups[c].push_back(group);
+                }
+            }
+        }
+        group_cells.back().push_back(keyed[i].second);
+    }
+    return true;
+}
+
+/**
+ * Splits the groups into components linked by shared numbers. Groups of a component are
+ * listed in breadth-first order, so enumeration completes numbers early and prunes sooner.
+ */
+void ProbabilityEngine::BuildComponents() {
+    components.clear();
+    vector<uint8_t> group_seen(group_cells.size(), 0);
+    vector<uint8_t> constraint_seen(constraint_target.size(), 0);
+    for (size_t start = 0; start < group_cells.size(); start++) {
+        if (group_seen[start]) {
+            continue;
+        }
+        components.push_back({(int)start});
+        vector<int> &order = components.back();
+        group_seen[start] = 1;
+        for (size_t next = 0; next < order.size(); next++) {
+            for (int c : group_constraints[order[next]]) {
+                if (constraint_seen[c]) {
+                    continue;
+                }
+                constraint_seen[c] = 1;
+                for (int g : constraint_groups[c]) {
+                    if (!group_seen[g]) {
+                        group_seen[g] = 1;
+                        order.push_back(g);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Backtracks over the number of mines in each group of a component. A group of size n holding j
+ * mines stands for n choose j layouts. Every number bounds j by the mines it still needs and the
+ * cells it still has free, so a number is always met exactly once its last group is set.
+ * @param order groups of the component
+ * @param position next group to assign
+ * @param mines mines assigned so far
+ * @param weight layouts represented by the assignment so far
+ */
+void ProbabilityEngine::Enumerate(const vector<int> &order, size_t position, int mines, double weight) {
+    if (position == order.size()) {
+        solutions[mines] += weight;
+        vector<double> &expected = solution_group_mines[mines];
+        for (size_t p = 0; p < order.size(); p++) {
+            expected[p] += weight * group_mines[order[p]];
+        }
+        return;
+    }
+    int group = order[position];
+    int size = group_cells[group].size();
+    int low = 0;
+    int high = min(size, mine_limit - mines);
+    for (int c : group_constraints[group]) {
+        int need = constraint_target[c] - constraint_mines[c];
+        high = min(high, need);
+        low = max(low, need - (constraint_free[c] - size));
+    }
+    for (int c : group_constraints[group]) {
+        constraint_free[c] -= size;
+    }
+    for (int j = low; j <= high; j++) {
+        for (int c : group_constraints[group]) {
+            constraint_mines[c] += j;
+        }
+        group_mines[group] = j;
+        Enumerate(order, position + 1, mines + j, weight * CHOOSE.entry[size][j]);
+        for (int c : group_constraints[group]) {
+            constraint_mines[c] -= j;
+        }
+    }
+    for (int c : group_constraints[group]) {
+        constraint_free[c] += size;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef PROBABILITY_H
+#define PROBABILITY_H
+
+#include "logic.h"
+#include <vector>
+
+/**
+ * Exact probability of a mine under every cell of a player grid.
+ * Unopened cells next to opened numbers form the frontier. Frontier cells touching exactly the
+ * same numbers are merged into groups, groups linked through shared numbers form independent
+ * components, and each component is enumerated by backtracking over the number of mines per
+ * group. Components are then combined with the cells away from the frontier, whose share of the
+ * remaining mines is weighted by binomial coefficients computed in log space.
+ * Flagged cells are taken as mines, matching Board::GetFlagsLeft.
+ * Buffers are kept between calls, reuse one engine for repeated queries.
+ */
+class ProbabilityEngine {
+public:
+    bool Compute(GridView, int);
+
+    const std::vector<double> &GetProbabilities() const;
+    int GetComponentCount() const;
+
+private:
+    std::vector<double> probabilities;
+    //Index of the number constraining each opened cell, -1 if it constrains nothing
+    std::vector<int> constraint_of;
+    std::vector<int> constraint_target;
+    std::vector<std::vector<int>> constraint_groups;
+    std::vector<std::vector<int>> group_cells;
+    std::vector<std::vector<int>> group_constraints;
+    std::vector<std::vector<int>> components;
+
+    //Enumeration state of the current component
+    std::vector<int> constraint_mines;
+    std::vector<int> constraint_free;
+    std::vector<int> group_mines;
+    //Weighted solution count and weighted mines per group, by mines in the component
+    std::vector<double> solutions;
+    std::vector<std::vector<double>> solution_group_mines;
+    int mine_limit = 0;
+
+    bool BuildGroups(GridView view, std::vector<int> &interior);
+    void BuildComponents();
+    void Enumerate(const std::vector<int> &order, size_t position, int mines, double weight);
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "protocol.h"
+#include <sstream>
+using namespace std;
+
+//Protocol character of every player grid value, see GridView::At
+const char CELL_CHARS[] = "012345678*.F";
+const char *const STATE_NAMES[] = {"playing", "won", "lost"};
+
+/**
+ * Runs one command line and writes its reply line, without flushing
+ * @param line command, see ProtocolEngine
+ * @param out stream the reply is written to
+ * @return false once the command is quit
+ */
+bool ProtocolEngine::Execute(const string &line, ostream &out) {
+    istringstream in(line);
+    string command;
+    if (!(in >> command)) {
+        out << "error empty command\n";
+        return true;
+    }
+    if (command == "quit") {
+        return false;
+    }
+
+    if (command == "new") {
+        string size;
+        in >> size;
+        Level level = size == "easy" ? EASY : size == "normal" ? NORMAL : HARD;
+        bool preset = size == "easy" || size == "normal" || size == "hard";
+        long height = 0, width = 0, mines = 0;
+        if (!preset) {
+            istringstream dimensions(size);
+            if (!(dimensions >> height) || !(in >> width >> mines) || height <= 0 || width <= 0 || mines <= 0 ||
+                height > UINT16_MAX || width > UINT16_MAX || mines > UINT32_MAX) {
+                out << "error expected new easy|normal|hard or new HEIGHT WIDTH MINES\n";
+                return true;
+            }
+        }
+        uint64_t seed = RandomSeed();
+        string rule = "any";
+        string word;
+        if (in >> word) {
+            istringstream number(word);
+            if (number >> seed) {
+                in >> rule;
+            } else {
+                rule = word;
+            }
+        }
+        FirstClick first_click = rule == "safe" ? FIRST_CLICK_SAFE : rule == "opening" ? FIRST_CLICK_OPENING : FIRST_CLICK_ANY;
+        if (rule != "any" && rule != "safe" && rule != "opening") {
+            out << "error unknown first click rule " << rule << '\n';
+            return true;
+        }
+        board.reset(preset ? new Board(level, seed, first_click) : new Board(height, width, mines, seed, first_click));
+        out << "ok " << board->GetHeight() << ' ' << board->GetWidth() << ' ' << board->GetFlagsLeft() << ' ' << seed << '\n';
+        return true;
+    }
+
+    if (!board) {
+        out << "error no game, start one with new\n";
+        return true;
+    }
+    if (command == "state") {
+        GridView view = board->GetView();
+        out << STATE_NAMES[board->GetState()] << ' ' << board->GetFlagsLeft() << ' ' << board->GetMoves() << ' ';
+        string grid(view.GetHeight() * view.GetWidth(), '.');
+        for (size_t i = 0; i < grid.size(); i++) {
+            grid[i] = CELL_CHARS[view.At(i)];
+        }
+        out << grid << '\n';
+        return true;
+    }
+    if (command == "delta") {
+        WriteChanges(out);
+        return true;
+    }
+    if (command != "open" && command != "flag" && command != "chord") {
+        out << "error unknown command " << command << '\n';
+        return true;
+    }
+    int row, col;
+    if (!(in >> row >> col) || row < 0 || col < 0 || row >= board->GetHeight() || col >= board->GetWidth()) {
+        out << "error expected " << command << " ROW COL on the board\n";
+        return true;
+    }
+    if (board->GetState() != PLAYING) {
+        //A finished game keeps its result, start another with new
+        out << "error game over\n";
+        return true;
+    }
+    if (command == "chord" && board->GetView().At(row, col) >= 9) {
+        //Only opened cells chord, the last move stays the one delta reports
+        out << STATE_NAMES[board->GetState()] << " 0\n";
+        return true;
+    }
+    if (command == "flag") {
+        board->Flag(row, col);
+    } else {
+        board->Open(row, col);
+    }
+    WriteChanges(out);
+    return true;
+}
+
+/**
+ * Writes the state and the cells changed by the last move
+ */
+void ProtocolEngine::WriteChanges(ostream &out) {
+    GridView view = board->GetView();
+    int width = view.GetWidth();
+    const vector<int> &changes = board->GetChanges();
+    out << STATE_NAMES[board->GetState()] << ' ' << changes.size();
+    for (int index : changes) {
+        out << ' ' << index / width << ' ' << index % width << ' ' << CELL_CHARS[view.At(index)];
+    }
+    out << '\n';
+}
@@ -0,0 +1,40 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "logic.h"
+#include <memory>
+#include <ostream>
+#include <string>
+
+/**
+ * Line-based text protocol to drive a Board from another process, one command per line and one
+ * reply line per command. Cells are given as row and column, cell values as one character:
+ * '0'-'8' opened numbers, '*' a mine (shown once lost), '.' unopened and 'F' flagged.
+ *
+ *   new easy|normal|hard [SEED] [any|safe|opening]       ok HEIGHT WIDTH MINES SEED
+ *   new HEIGHT WIDTH MINES [SEED] [any|safe|opening]     (invalid sizes fall back to easy)
+ *   open ROW COL                                         STATE COUNT ROW COL VALUE ...
+ *   flag ROW COL                                         STATE COUNT ROW COL VALUE ...
+ *   chord ROW COL                                        STATE COUNT ROW COL VALUE ...
+ *   delta                                                changes of the last move again
+ *   state                                                STATE FLAGS_LEFT MOVES GRID
+ *   quit
+ *
+ * STATE is playing, won or lost. Move replies list only the cells whose value changed, see
+ * Board::GetChanges. chord only acts on an opened cell and otherwise replies with no changes.
+ * Once the game is won or lost, open, flag and chord reply "error game over" and change nothing.
+ * GRID is every cell value row by row.
+ * Errors reply with "error" and a message. The new game uses a random seed unless one is given,
+ * and the first click rule defaults to any.
+ */
+class ProtocolEngine {
+public:
+    bool Execute(const std::string &, std::ostream &);
+
+private:
+    std::unique_ptr<Board> board;
+
+    void WriteChanges(std::ostream &);
+};
+
+#endif
@@ -0,0 +1,413 @@
+#include "replay.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+using namespace std;
+
+const uint8_t REPLAY_MAGIC[4] = {'M', 'S', 'R', 'P'};
+//Version 1 had no keyframes, version 2 adds them with their index footer
+const uint8_t REPLAY_VERSION = 2;
+const uint8_t KEYFRAME_MAGIC[4] = {'M', 'S', 'K', 'I'};
+//Footer index entry: 8-byte offset, 4-byte move, 4-byte size
+const size_t KEYFRAME_ENTRY = 16;
+
+/**
+ * Appends an unsigned LEB128 varint, 7 bits per byte with the high bit set on all but the last
+ */
+static void PutVarint(vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+/**
+ * Appends a little-endian integer of the given number of bytes
+ */
+static void PutFixed(vector<uint8_t> &out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(value >> (8 * i));
+    }
+}
+
+/**
+ * @return little-endian integer of the given number of bytes
+ */
+static uint64_t GetFixed(const uint8_t *at, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t)at[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Reads a varint written by PutVarint
+ * @param at read position, advanced past the varint
+ * @return false if the data ends first or the varint is longer than 64 bits
+ */
+static bool GetVarint(const uint8_t *&at, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (at == end) {
+            return false;
+        }
+        uint8_t byte = *at++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Appends a replay in its binary form:
+ * - "MSRP", version byte
+ * - varints height, width, mines, the seed as 8 little-endian bytes, first click and result bytes
+ * - varints duration and move count
+ * - per move a varint of the time since the previous move, and a varint of the zigzag encoded
+ *   index delta from the previous move shifted left once, with the action in the low bit
+ * - varint keyframe count, per keyframe varints of the number of moves played and the snapshot
+ *   size, then the board snapshot written by Board::Save with the time of its last move
+ * - footer index: per keyframe the snapshot offset from the start of the replay (8 bytes), the
+ *   number of moves played (4) and the snapshot size (4), then the keyframe count (4) and "MSKI",
+ *   all little-endian, so a reader finds every keyframe from the end of the replay
+ * Moves near each other in time and space, as in normal play, take 2-3 bytes.
+ * @param out buffer the replay is appended to, replays can be concatenated
+ * @param keyframe_interval if positive, a keyframe is taken after this many moves since the last
+ * one, or sooner once those moves revealed a quarter of the board
+ */
+void EncodeReplay(const Replay &replay, vector<uint8_t> &out, int keyframe_interval) {
+    size_t start = out.size();
+    out.insert(out.end(), REPLAY_MAGIC, REPLAY_MAGIC + 4);
+    out.push_back(REPLAY_VERSION);
+    PutVarint(out, replay.height);
+    PutVarint(out, replay.width);
+    PutVarint(out, replay.mines);
+    PutFixed(out, replay.seed, 8);
+    out.push_back(replay.first_click);
+    out.push_back(replay.result);
+    PutVarint(out, replay.duration);
+    PutVarint(out, replay.moves.size());
+    uint32_t time = 0;
+    int64_t index = 0;
+    for (const ReplayMove &move : replay.moves) {
+        PutVarint(out, move.time - time);
+        int64_t delta = move.index - index;
+        uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+        PutVarint(out, (zigzag << 1) | move.action);
+        time = move.time;
+        index = move.index;
+    }
+
+    //Keyframes are written to their own buffer first, their count comes before them
+    vector<uint8_t> keyframes;
+    vector<array<uint64_t, 3>> entries;
+    if (keyframe_interval > 0) {
+        Board board(replay.height, replay.width, replay.mines, replay.seed, replay.first_click);
+        //Board falls back to easy mode on invalid sizes, those replays get no keyframes
+        bool valid = board.GetHeight() == replay.height && board.GetWidth() == replay.width && board.GetFlagsLeft() == (int)replay.mines;
+        int width = replay.width;
+        int cells = replay.height * width;
+        size_t last = 0;
+        int revealed = 0;
+        vector<uint8_t> snapshot;
+        for (size_t played = 1; valid && played <= replay.moves.size(); played++) {
+            const ReplayMove &move = replay.moves[played - 1];
+            if (move.index < 0 || move.index >= cells) {
+                break;
+            }
+            if (move.action == REPLAY_OPEN) {
+                board.Open(move.index / width, move.index % width);
+                revealed += board.GetChanges().size();
+            } else {
+                board.Flag(move.index / width, move.index % width);
+            }
+            if (played - last >= (size_t)keyframe_interval || revealed >= cells / 4) {
+                snapshot.clear();
+                board.Save(snapshot, move.time);
+                PutVarint(keyframes, played);
+                PutVarint(keyframes, snapshot.size());
+                entries.push_back({keyframes.size(), played, snapshot.size()});
+                keyframes.insert(keyframes.end(), snapshot.begin(), snapshot.end());
+                last = played;
+                revealed = 0;
+            }
+        }
+    }
+    PutVarint(out, entries.size());
+    size_t base = out.size() - start;
+    out.insert(out.end(), keyframes.begin(), keyframes.end());
+    for (const array<uint64_t, 3> &entry : entries) {
+        PutFixed(out, base + entry[0], 8);
+        PutFixed(out, entry[1], 4);
+        PutFixed(out, entry[2], 4);
+    }
+    PutFixed(out, entries.size(), 4);
+    out.insert(out.end(), KEYFRAME_MAGIC, KEYFRAME_MAGIC + 4);
+}
+
+/**
+ * Reads a replay written by EncodeReplay
+ * @param data start of the replay
+ * @param size bytes available, may hold further replays
+ * @param replay set to the replay read
+ * @return bytes used, or 0 if the data is not a valid replay
+ */
+size_t DecodeReplay(const uint8_t *data, size_t size, Replay &replay) {
+    const uint8_t *at = data;
+    const uint8_t *end = data + size;
+    if (size < 5 + 8 + 2 || !equal(REPLAY_MAGIC, REPLAY_MAGIC + 4, at) || at[4] < 1 || at[4] > REPLAY_VERSION) {
+        return 0;
+    }
+    uint8_t version = at[4];
+    at += 5;
+    uint64_t height, width, mines, duration, count;
+    if (!GetVarint(at, end, height) || !GetVarint(at, end, width) || !GetVarint(at, end, mines) || end - at < 10) {
+        return 0;
+    }
+    uint64_t seed = 0;
+    for (int i = 0; i < 8; i++) {
+        seed |= (uint64_t)*at++ << (8 * i);
+    }
+    uint8_t first_click = *at++;
+    uint8_t result = *at++;
+    if (!GetVarint(at, end, duration) || !GetVarint(at, end, count)) {
+        return 0;
+    }
+    //Every move takes at least two bytes
+    if (height > UINT16_MAX || width > UINT16_MAX || mines > UINT32_MAX || duration > UINT32_MAX ||
+        first_click > FIRST_CLICK_OPENING || result > LOST || count > (uint64_t)(end - at) / 2) {
+        return 0;
+    }
+    replay.height = height;
+    replay.width = width;
+    replay.mines = mines;
+    replay.seed = seed;
+    replay.first_click = (FirstClick)first_click;
+    replay.result = (GameState)result;
+    replay.duration = duration;
+    replay.moves.resize(count);
+    uint64_t time = 0;
+    int64_t index = 0;
+    for (ReplayMove &move : replay.moves) {
+        uint64_t step, code;
+        if (!GetVarint(at, end, step) || !GetVarint(at, end, code)) {
+            return 0;
+        }
+        uint64_t zigzag = code >> 1;
+        time += step;
+        index += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        if (time > UINT32_MAX || index < 0 || index > INT32_MAX) {
+            return 0;
+        }
+        move.time = time;
+        move.action = (ReplayAction)(code & 1);
+        move.index = index;
+    }
+    if (version < 2) {
+        return at - data;
+    }
+
+    //Skip the keyframes, then check the footer agrees on their count
+    uint64_t keyframes;
+    if (!GetVarint(at, end, keyframes) || keyframes > (uint64_t)(end - at) / KEYFRAME_ENTRY) {
+        return 0;
+    }
+    for (uint64_t k = 0; k < keyframes; k++) {
+        uint64_t played, snapshot;
+        if (!GetVarint(at, end, played) || !GetVarint(at, end, snapshot) || snapshot > (uint64_t)(end - at)) {
+            return 0;
+        }
+        at += snapshot;
+    }
+    size_t footer = keyframes * KEYFRAME_ENTRY + 8;
+    if ((size_t)(end - at) < footer || GetFixed(at + footer - 8, 4) != keyframes || !equal(KEYFRAME_MAGIC, KEYFRAME_MAGIC + 4, at + footer - 4)) {
+        return 0;
+    }
+    return at + footer - data;
+}
+
+/**
+ * Writes a replay to a file
+ * @param keyframe_interval see EncodeReplay
+ * @return false if the file could not be written
+ */
+bool SaveReplay(const Replay &replay, const string &path, int keyframe_interval) {
+    vector<uint8_t> data;
+    EncodeReplay(replay, data, keyframe_interval);
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write((const char *)data.data(), data.size());
+    out.close();
+    return !out.fail();
+}
+
+/**
+ * Reads a replay file holding a single replay
+ * @return false if the file is missing or not a valid replay
+ */
+bool LoadReplay(const string &path, Replay &replay) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return false;
+    }
+    vector<uint8_t> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return !data.empty() && DecodeReplay(data.data(), data.size(), replay) == data.size();
+}
+
+/**
+ * Plays the moves of a replay on a board
+ * @return true if every move is on the board, no move follows the end of the game, times never
+ * go back, and the final state and the time of the last move match the claimed result
+ */
+template <typename B>
+static bool PlayReplay(const Replay &replay, B &board) {
+    int width = replay.width;
+    int cells = replay.height * width;
+    GameState state = PLAYING;
+    uint32_t time = 0;
+    for (const ReplayMove &move : replay.moves) {
+        if (state != PLAYING || move.index < 0 || move.index >= cells || move.time < time) {
+            return false;
+        }
+        time = move.time;
+        if (move.action == REPLAY_OPEN) {
+            state = board.Open(move.index / width, move.index % width);
+        } else {
+            board.Flag(move.index / width, move.index % width);
+        }
+    }
+    return state == replay.result && time == replay.duration;
+}
+
+/**
+ * Plays a replay again on the board it was recorded on, see PlayReplay. Presets are played on
+ * the fixed preset boards, which give the same games as Board.
+ */
+bool VerifyReplay(const Replay &replay) {
+    int height = replay.height;
+    int width = replay.width;
+    int mines = replay.mines;
+    if (height == 9 && width == 9 && mines == 10) {
+        EasyBoard board(replay.seed, replay.first_click);
+        return PlayReplay(replay, board);
+    } else if (height == 16 && width == 16 && mines == 40) {
+        NormalBoard board(replay.seed, replay.first_click);
+        return PlayReplay(replay, board);
+    } else if (height == 16 && width == 30 && mines == 99) {
+        HardBoard board(replay.seed, replay.first_click);
+        return PlayReplay(replay, board);
+    }
+    Board board(replay.height, replay.width, replay.mines, replay.seed, replay.first_click);
+    //Board falls back to easy mode on invalid sizes
+    if (board.GetHeight() != height || board.GetWidth() != width || board.GetFlagsLeft() != mines) {
+        return false;
+    }
+    return PlayReplay(replay, board);
+}
+
+/**
+ * Reads an encoded replay and its keyframe index
+ * @param data encoded replay, must stay valid while seeking
+ * @param size bytes available
+ * @return false if the data does not start with a valid replay
+ */
+bool ReplaySeeker::Open(const uint8_t *data, size_t size) {
+    size_t used = DecodeReplay(data, size, replay);
+    this->data = data;
+    keyframes = 0;
+    if (used == 0) {
+        return false;
+    }
+    if (data[4] < 2) {
+        return true;
+    }
+    //The footer ends the replay, its entries must be in move order and inside the replay
+    keyframes = GetFixed(data + used - 8, 4);
+    index = data + used - 8 - keyframes * KEYFRAME_ENTRY;
+    uint32_t previous = 0;
+    for (int k = 0; k < keyframes; k++) {
+        uint64_t offset;
+        uint32_t played, snapshot;
+        ReadEntry(k, offset, played, snapshot);
+        if (played < previous || played > replay.moves.size() || offset > used || snapshot > used - offset) {
+            keyframes = 0;
+            return false;
+        }
+        previous = played;
+    }
+    return true;
+}
+
+const Replay &ReplaySeeker::GetReplay() const {
+    return replay;
+}
+int ReplaySeeker::GetKeyframeCount() const {
+    return keyframes;
+}
+
+/**
+ * Sets a board to the position after a number of moves of the replay
+ * @param board board to set, resized as needed
+ * @param move number of moves played, clamped to the length of the replay
+ * @return false if a keyframe is corrupted or the replay is not playable
+ */
+bool ReplaySeeker::Seek(Board &board, int move) {
+    int target = min(max(move, 0), (int)replay.moves.size());
+    //Last keyframe at or before the target
+    int low = 0;
+    int high = keyframes;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        uint64_t offset;
+        uint32_t played, snapshot;
+        ReadEntry(middle, offset, played, snapshot);
+        if ((int)played <= target) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    int played_moves = 0;
+    if (low > 0) {
+        uint64_t offset;
+        uint32_t played, snapshot, elapsed;
+        ReadEntry(low - 1, offset, played, snapshot);
+        if (!board.Load(data + offset, snapshot, elapsed)) {
+            return false;
+        }
+        played_moves = played;
+    } else {
+        board = Board(replay.height, replay.width, replay.mines, replay.seed, replay.first_click);
+        if (board.GetHeight() != replay.height || board.GetWidth() != replay.width) {
+            return false;
+        }
+    }
+    int width = replay.width;
+    int cells = replay.height * width;
+    for (int i = played_moves; i < target; i++) {
+        const ReplayMove &step = replay.moves[i];
+        if (step.index >= cells) {
+            return false;
+        }
+        if (step.action == REPLAY_OPEN) {
+            board.Open(step.index / width, step.index % width);
+        } else {
+            board.Flag(step.index / width, step.index % width);
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads entry k of the footer index
+ */
+void ReplaySeeker::ReadEntry(int k, uint64_t &offset, uint32_t &played, uint32_t &snapshot) const {
+    const uint8_t *entry = index + k * KEYFRAME_ENTRY;
+    offset = GetFixed(entry, 8);
+    played = GetFixed(entry + 8, 4);
+    snapshot = GetFixed(entry + 12, 4);
+}
@@ -0,0 +1,75 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "logic.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Player actions kept in a replay.
+ */
+enum ReplayAction {
+    REPLAY_OPEN,
+    REPLAY_FLAG,
+};
+
+/**
+ * One recorded action
+ */
+struct ReplayMove {
+    //Milliseconds since the first move
+    uint32_t time;
+    ReplayAction action;
+    //Flat index (row * width + col) of the cell acted on
+    int index;
+};
+
+/**
+ * Record of a game: the board it was played on, every Open and Flag in order and the outcome
+ * claimed for it, which VerifyReplay checks by playing the moves again.
+ */
+struct Replay {
+    uint16_t height = 0;
+    uint16_t width = 0;
+    uint32_t mines = 0;
+    uint64_t seed = 0;
+    FirstClick first_click = FIRST_CLICK_ANY;
+    //Claimed final state, and time of the last move
+    GameState result = PLAYING;
+    uint32_t duration = 0;
+    std::vector<ReplayMove> moves;
+};
+
+void EncodeReplay(const Replay &, std::vector<uint8_t> &, int keyframe_interval = 0);
+size_t DecodeReplay(const uint8_t *, size_t, Replay &);
+bool SaveReplay(const Replay &, const std::string &, int keyframe_interval = 0);
+bool LoadReplay(const std::string &, Replay &);
+bool VerifyReplay(const Replay &);
+
+/**
+ * Random access to the positions of an encoded replay. The keyframe index in the footer gives
+ * the nearest board snapshot before a move, so a seek costs one snapshot load plus the moves
+ * after it, bounded by the keyframe interval. Replays without keyframes seek from the start.
+ */
+class ReplaySeeker {
+public:
+    bool Open(const uint8_t *, size_t);
+
+    const Replay &GetReplay() const;
+    int GetKeyframeCount() const;
+    bool Seek(Board &, int);
+
+private:
+    Replay replay;
+    //Encoded replay, owned by the caller
+    const uint8_t *data = nullptr;
+    //First entry of the footer index
+    const uint8_t *index = nullptr;
+    int keyframes = 0;
+
+    void ReadEntry(int, uint64_t &, uint32_t &, uint32_t &) const;
+};
+
+#endif
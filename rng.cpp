@@ -0,0 +1,12 @@
+#include "rng.h"
+#include <chrono>
+#include <random>
+
+/**
+ * @return a fresh seed for games that are not asked to be reproducible
+ */
+uint64_t RandomSeed() {
+    std::random_device device;
+    uint64_t seed = ((uint64_t)device() << 32) ^ device();
+    return seed ^ (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+}
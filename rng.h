@@ -0,0 +1,112 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+/**
+ * SplitMix64 generator, used to expand a single 64-bit seed into generator state.
+ */
+class SplitMix64 {
+public:
+    SplitMix64(uint64_t);
+    uint64_t operator()();
+
+private:
+    uint64_t state;
+};
+
+/**
+ * xoshiro256** generator. Fast, 256 bits of state and the same output on every platform
+ * for the same seed. Satisfies UniformRandomBitGenerator so it also works with <random>.
+ */
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    Xoshiro256(uint64_t);
+    uint64_t operator()();
+
+    static constexpr uint64_t min() {
+        return 0;
+    }
+    static constexpr uint64_t max() {
+        return UINT64_MAX;
+    }
+
+private:
+    uint64_t s[4];
+};
+
+/**
+ * @param seed initial state
+ */
+inline SplitMix64::SplitMix64(uint64_t seed) : state{seed} {}
+
+/**
+ * @return next 64-bit output
+ */
+inline uint64_t SplitMix64::operator()() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Seed of item index of a batch (a game, a candidate board), taken from output index of the
+ * SplitMix64 stream seeded with base. SplitMix64 is a counter with a mixing step, so any output
+ * can be computed directly and the seed does not depend on which thread asks first.
+ */
+inline uint64_t StreamSeed(uint64_t base, uint64_t index) {
+    return SplitMix64{base + index * 0x9e3779b97f4a7c15ULL}();
+}
+
+/**
+ * Seeds the state through SplitMix64, so any seed including 0 gives a valid state
+ * @param seed 64-bit seed
+ */
+inline Xoshiro256::Xoshiro256(uint64_t seed) {
+    SplitMix64 expand{seed};
+    for (int i = 0; i < 4; i++) {
+        s[i] = expand();
+    }
+}
+
+/**
+ * @return next 64-bit output
+ */
+inline uint64_t Xoshiro256::operator()() {
+    auto rotl = [](uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    };
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+/**
+ * Draws an integer uniformly from [0, bound) by rejection, free of modulo bias and
+ * identical on every platform.
+ * @param gen generator returning uniform 64-bit values
+ * @param bound exclusive upper bound, must be greater than 0
+ */
+template <typename Gen>
+uint64_t UniformBelow(Gen &gen, uint64_t bound) {
+    //Smallest value of a full range of bound, values below it would bias the result
+    uint64_t threshold = (0 - bound) % bound;
+    uint64_t x;
+    do {
+        x = gen();
+    } while (x < threshold);
+    return x % bound;
+}
+
+uint64_t RandomSeed();
+
+#endif
@@ -1,15 +1,15 @@
 #ifndef SCENE_CPP
 #define SCENE_CPP
 
-#include <SDL2\SDL.h>
-#include <SDL2\SDL_ttf.h>
+#include "text.cpp"
+#include <SDL2/SDL.h>
 
 /**
  * An abstract class for storage of scenes
  */
 class Scene {
 public:
-    Scene(SDL_Window *, TTF_Font *);
+    Scene(SDL_Window *, GlyphAtlas *);
 
     /**
      * List of scenes throughout the application
@@ -24,20 +24,46 @@ public:
     virtual void Render() = 0;
     virtual void Free() = 0;
     virtual void HandleEvent(SDL_Event *) = 0;
+    virtual bool IsDirty();
+    virtual Sint32 GetRedrawDelay();
+    void SetDirty(bool);
     void Resize();
 
 protected:
     void SetWindowSize(size_t, size_t);
     SDL_Window *g_window;
-    TTF_Font *g_font;
+    GlyphAtlas *g_text;
     int win_width;
     int win_height;
+    //Set when the scene looks different from the last Render
+    bool dirty{true};
 };
 
 /**
- * Initialise global window and font
+ * Initialise global window and text renderer
  */
-Scene::Scene(SDL_Window *window, TTF_Font *font) : g_window{window}, g_font{font} {}
+Scene::Scene(SDL_Window *window, GlyphAtlas *text) : g_window{window}, g_text{text} {}
+
+/**
+ * @return true if the scene has to be rendered again
+ */
+bool Scene::IsDirty() {
+    return dirty;
+}
+
+/**
+ * @return milliseconds until the scene changes without any event, or -1 if it only changes on events
+ */
+Sint32 Scene::GetRedrawDelay() {
+    return -1;
+}
+
+/**
+ * Marks the scene as needing to be rendered again, or as up to date after rendering
+ */
+void Scene::SetDirty(bool value) {
+    dirty = value;
+}
 
 /**
  * Sets the size of the window containing this scene.
@@ -79,6 +105,7 @@ public:
 void SceneManager::Transition(Scene::States state) {
     curr_scene = all_scene[state];
     curr_scene->Resize();
+    curr_scene->SetDirty(true);
 }
 
 /**
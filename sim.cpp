@@ -0,0 +1,225 @@
+#include "logic.h"
+#include "player.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * Monte Carlo win rate simulator, built as minesweeper_sim. Plays games with the built-in
+ * Player policy, spread over threads.
+ *
+ * Usage: minesweeper_sim [--level easy|normal|hard] [--custom HEIGHT WIDTH MINES] [--first-click any|safe|opening] [--games N] [--threads N] [--seed N] [--scaling] [--dynamic]
+ *   --level        preset to play, default hard
+ *   --custom       custom board instead of a preset
+ *   --first-click  mine placement, see FirstClick, default any
+ *   --games        number of games, default 100000
+ *   --threads      number of threads, default all cores
+ *   --seed         base seed, default 1
+ *   --scaling      repeat the run for 1, 2, 4, ... threads up to --threads and report the speedup
+ *   --dynamic      play presets on Board instead of the fixed preset boards, results are the same
+ *
+ * Game i always plays the board seeded by output i of a SplitMix64 stream over the base seed,
+ * whatever the thread count, so every run is reproducible and results do not depend on threads.
+ */
+
+using Clock = chrono::steady_clock;
+
+/**
+ * Board parameters of a run
+ */
+struct Setup {
+    int height;
+    int width;
+    int mines;
+    //Preset to play, or -1 for a custom board
+    int level;
+    FirstClick first_click;
+    //Play presets on Board instead of EasyBoard, NormalBoard or HardBoard
+    bool dynamic;
+};
+
+/**
+ * Totals over a range of games
+ */
+struct Tally {
+    long long games = 0;
+    long long wins = 0;
+    long long guesses = 0;
+};
+
+/**
+ * @return board of game with the given seed, B is Board or the fixed board of the preset
+ */
+template <typename B>
+B MakeBoard(const Setup &setup, uint64_t seed) {
+    return B(seed, setup.first_click);
+}
+template <>
+Board MakeBoard<Board>(const Setup &setup, uint64_t seed) {
+    return setup.level >= 0 ? Board((Level)setup.level, seed, setup.first_click)
+                            : Board(setup.height, setup.width, setup.mines, seed, setup.first_click);
+}
+
+/**
+ * Plays games [begin, end), each thread owns its own Player and Tally. Counts are kept in a local
+ * Tally and written to result once at the end, as the results of all threads share cache lines.
+ */
+template <typename B>
+void PlayRange(const Setup &setup, uint64_t base, long long begin, long long end, Tally &result) {
+    Player player;
+    Tally tally;
+    for (long long game = begin; game < end; game++) {
+        B board = MakeBoard<B>(setup, StreamSeed(base, game));
+        tally.games += 1;
+        tally.wins += player.Play(board) == WON;
+        tally.guesses += player.GetGuesses();
+    }
+    result = tally;
+}
+
+/**
+ * Runs games split into one contiguous block per thread
+ * @param seconds set to the wall time of the run
+ * @return totals of all threads
+ */
+Tally Simulate(const Setup &setup, uint64_t base, long long games, int threads, double &seconds) {
+    vector<Tally> tallies(threads);
+    vector<thread> workers;
+    auto start = Clock::now();
+    //Presets play on boards with compile-time dimensions unless asked otherwise
+    auto play = PlayRange<Board>;
+    if (!setup.dynamic && setup.level == EASY) {
+        play = PlayRange<EasyBoard>;
+    } else if (!setup.dynamic && setup.level == NORMAL) {
+        play = PlayRange<NormalBoard>;
+    } else if (!setup.dynamic && setup.level == HARD) {
+        play = PlayRange<HardBoard>;
+    }
+    for (int t = 0; t < threads; t++) {
+        long long begin = games * t / threads;
+        long long end = games * (t + 1) / threads;
+        workers.emplace_back(play, cref(setup), base, begin, end, ref(tallies[t]));
+    }
+    Tally total;
+    for (int t = 0; t < threads; t++) {
+        workers[t].join();
+        total.games += tallies[t].games;
+        total.wins += tallies[t].wins;
+        total.guesses += tallies[t].guesses;
+    }
+    seconds = chrono::duration<double>(Clock::now() - start).count();
+    return total;
+}
+
+/**
+ * 95% Wilson score interval of a binomial proportion
+ */
+void WilsonInterval(long long successes, long long trials, double &low, double &high) {
+    const double z = 1.96;
+    double p = (double)successes / trials;
+    double n = trials;
+    double centre = (p + z * z / (2 * n)) / (1 + z * z / n);
+    double half = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+    low = centre - half;
+    high = centre + half;
+}
+
+int main(int argc, char *argv[]) {
+    Setup setup{16, 30, 99, HARD, FIRST_CLICK_ANY, false};
+    long long games = 100000;
+    int threads = max(1u, thread::hardware_concurrency());
+    uint64_t seed = 1;
+    bool scaling = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 < argc && arg == "--level") {
+            string level = argv[++i];
+            if (level == "easy") {
+                setup = {9, 9, 10, EASY, setup.first_click, setup.dynamic};
+            } else if (level == "normal") {
+                setup = {16, 16, 40, NORMAL, setup.first_click, setup.dynamic};
+            } else if (level == "hard") {
+                setup = {16, 30, 99, HARD, setup.first_click, setup.dynamic};
+            } else {
+                fprintf(stderr, "Unknown level %s, expected easy, normal or hard\n", level.c_str());
+                return 2;
+            }
+        } else if (i + 3 < argc && arg == "--custom") {
+            setup.height = atoi(argv[++i]);
+            setup.width = atoi(argv[++i]);
+            setup.mines = atoi(argv[++i]);
+            setup.level = -1;
+        } else if (i + 1 < argc && arg == "--first-click") {
+            string rule = argv[++i];
+            if (rule == "any") {
+                setup.first_click = FIRST_CLICK_ANY;
+            } else if (rule == "safe") {
+                setup.first_click = FIRST_CLICK_SAFE;
+            } else if (rule == "opening") {
+                setup.first_click = FIRST_CLICK_OPENING;
+            } else {
+                fprintf(stderr, "Unknown first click rule %s, expected any, safe or opening\n", rule.c_str());
+                return 2;
+            }
+        } else if (i + 1 < argc && arg == "--games") {
+            games = atoll(argv[++i]);
+        } else if (i + 1 < argc && arg == "--threads") {
+            threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--seed") {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (arg == "--scaling") {
+            scaling = true;
+        } else if (arg == "--dynamic") {
+            setup.dynamic = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--level easy|normal|hard] [--custom HEIGHT WIDTH MINES] [--first-click any|safe|opening] [--games N] [--threads N] [--seed N] [--scaling] [--dynamic]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (games < 1 || threads < 1) {
+        fprintf(stderr, "--games and --threads must be at least 1\n");
+        return 2;
+    }
+    if (setup.level < 0) {
+        //Board falls back to easy mode on invalid input, report what is really played
+        Board probe(setup.height, setup.width, setup.mines, 0);
+        if (probe.GetHeight() != setup.height || probe.GetWidth() != setup.width || probe.GetFlagsLeft() != setup.mines) {
+            fprintf(stderr, "Invalid custom board %dx%d with %d mines\n", setup.height, setup.width, setup.mines);
+            return 2;
+        }
+    }
+
+    printf("%dx%d with %d mines, %lld games, seed %llu\n", setup.height, setup.width, setup.mines, games, (unsigned long long)seed);
+    vector<int> counts;
+    for (int t = 1; scaling && t < threads; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(threads);
+
+    double base_seconds = 0;
+    Tally first;
+    for (int count : counts) {
+        double seconds;
+        Tally tally = Simulate(setup, seed, games, count, seconds);
+        double low, high;
+        WilsonInterval(tally.wins, tally.games, low, high);
+        if (count != counts.front() && (tally.wins != first.wins || tally.guesses != first.guesses)) {
+            fprintf(stderr, "Results with %d threads differ from %d threads\n", count, counts.front());
+            return 1;
+        }
+        if (count == counts.front()) {
+            base_seconds = seconds;
+            first = tally;
+            printf("win rate %.4f%% (95%% CI %.4f%% - %.4f%%), %lld wins, %.3f guesses per game\n",
+                   100.0 * tally.wins / tally.games, 100 * low, 100 * high, tally.wins, (double)tally.guesses / tally.games);
+        }
+        printf("threads %3d  time %9.3f s  %12.0f games/s  speedup %5.2fx\n", count, seconds, tally.games / seconds, base_seconds / seconds);
+    }
+    return 0;
+}
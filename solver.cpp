@@ -0,0 +1,247 @@
+#include "solver.h"
+#include <algorithm>
+#include <bitset>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+using namespace std;
+
+/**
+ * @param mask non-zero window mask
+ * @return index of the lowest set bit
+ */
+static int LowestBit(uint64_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long bit;
+    _BitScanForward64(&bit, mask);
+    return (int)bit;
+#else
+    int bit = 0;
+    for (; !(mask & 1); mask >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * @return number of set bits in a window mask
+ */
+static int CountBits(uint64_t mask) {
+    return (int)bitset<64>(mask).count();
+}
+
+/**
+ * Creates a solver for a board and queues every number already opened on it
+ * @param view player grid of the board, the board must outlive the solver
+ */
+Solver::Solver(GridView view) : view{view}, height{view.GetHeight()}, width{view.GetWidth()}, neighbours{height, width} {
+    state.assign(height * width, SOLVER_UNKNOWN);
+    queued.assign(height * width, 0);
+    for (int i = 0; i < height * width; i++) {
+        if (view.At(i) <= 8) {
+            state[i] = SOLVER_OPENED;
+            Enqueue(i);
+        }
+    }
+}
+
+/**
+ * Takes in the cells changed by a move, e.g. Board::GetChanges after Open or Flag
+ * @param changes flat indices of changed cells
+ */
+void Solver::Update(const vector<int> &changes) {
+    for (int index : changes) {
+        if (state[index] != SOLVER_OPENED && view.At(index) <= 8) {
+            Reveal(index);
+        }
+    }
+}
+
+/**
+ * Propagates the queued constraints until nothing new can be deduced
+ * @return number of new deductions
+ */
+int Solver::Solve() {
+    size_t known = safe.size() + mines.size();
+    while (!queue.empty()) {
+        int index = queue.back();
+        queue.pop_back();
+        queued[index] = 0;
+        Examine(index);
+    }
+    return safe.size() + mines.size() - known;
+}
+
+/**
+ * @return knowledge about the cell at flat index
+ */
+SolverCell Solver::Get(int index) const {
+    return (SolverCell)state[index];
+}
+
+/**
+ * @return flat indices of every cell deduced safe, in the order found. Cells stay listed after
+ * they are opened, callers keep their own position in the list.
+ */
+const vector<int> &Solver::GetSafe() const {
+    return safe;
+}
+
+/**
+ * @return flat indices of every cell deduced to be a mine, in the order found
+ */
+const vector<int> &Solver::GetMines() const {
+    return mines;
+}
+
+/**
+ * Records an opened cell, its number and the numbers around it need another look
+ */
+void Solver::Reveal(int index) {
+    state[index] = SOLVER_OPENED;
+    Enqueue(index);
+    neighbours.ForEach(index, [&](int n) {
+        if (state[n] == SOLVER_OPENED) {
+            Enqueue(n);
+        }
+    });
+}
+
+/**
+ * Records a deduction about an unknown cell and queues the numbers it constrains
+ */
+void Solver::Mark(int index, SolverCell knowledge) {
+    state[index] = knowledge;
+    (knowledge == SOLVER_SAFE ? safe : mines).push_back(index);
+    neighbours.ForEach(index, [&](int n) {
+        if (state[n] == SOLVER_OPENED) {
+            Enqueue(n);
+        }
+    });
+}
+
+void Solver::Enqueue(int index) {
+    if (!queued[index]) {
+        queued[index] = 1;
+        queue.push_back(index);
+    }
+}
+
+/**
+ * Bit of a cell in the 7x7 window of a centre cell, covers the neighbours of every cell up
+ * to two rows and columns away from the centre
+ */
+static inline int WindowBit(int row, int col, int centre_row, int centre_col) {
+    return (row - centre_row + 3) * 7 + (col - centre_col + 3);
+}
+
+/**
+ * @param row row of an opened cell
+ * @param col column of an opened cell
+ * @param centre_row row of the window centre, at most two rows from row
+ * @param centre_col column of the window centre, at most two columns from col
+ * @param remaining set to the number of mines around the cell not yet deduced
+ * @return window bits of the unknown neighbours of the cell
+ */
+uint64_t Solver::UnknownMask(int row, int col, int centre_row, int centre_col, int &remaining) const {
+    uint64_t mask = 0;
+    remaining = view.At(row, col);
+    for (int r = max(row - 1, 0); r <= min(row + 1, height - 1); r++) {
+        for (int c = max(col - 1, 0); c <= min(col + 1, width - 1); c++) {
+            uint8_t knowledge = state[r * width + c];
+            if (knowledge == SOLVER_UNKNOWN) {
+                mask |= 1ULL << WindowBit(r, c, centre_row, centre_col);
+            } else if (knowledge == SOLVER_MINE) {
+                remaining -= 1;
+            }
+        }
+    }
+    return mask;
+}
+
+/**
+ * Marks every still unknown cell of a window mask
+ */
+void Solver::MarkMask(uint64_t mask, int centre, SolverCell knowledge) {
+    for (; mask; mask &= mask - 1) {
+        int bit = LowestBit(mask);
+        int index = centre + (bit / 7 - 3) * width + (bit % 7 - 3);
+        if (state[index] == SOLVER_UNKNOWN) {
+            Mark(index, knowledge);
+        }
+    }
+}
+
+/**
+ * Applies the rules to one opened number
+ * Single cell: no remaining mines means every unknown neighbour is safe, as many remaining
+ * mines as unknown neighbours means they are all mines.
+ * Subset and overlap: for a nearby number B sharing unknown cells S with this number A, the
+ * mines in S are bounded by both counts, which bounds the mines in A\S and B\S. A bound of 0
+ * makes a part safe, a bound equal to its size makes it all mines. A subset is the case A\S = {}.
+ */
+void Solver::Examine(int a) {
+    int row = a / width;
+    int col = a % width;
+    int remaining_a;
+    uint64_t mask_a = UnknownMask(row, col, row, col, remaining_a);
+    if (!mask_a) {
+        return;
+    }
+    int unknown_a = CountBits(mask_a);
+    if (remaining_a == 0) {
+        MarkMask(mask_a, a, SOLVER_SAFE);
+        return;
+    }
+    if (remaining_a == unknown_a) {
+        MarkMask(mask_a, a, SOLVER_MINE);
+        return;
+    }
+
+    for (int r = max(row - 2, 0); r <= min(row + 2, height - 1); r++) {
+        for (int c = max(col - 2, 0); c <= min(col + 2, width - 1); c++) {
+            int b = r * width + c;
+            if (b == a || state[b] != SOLVER_OPENED) {
+                continue;
+            }
+            int remaining_b;
+            uint64_t mask_b = UnknownMask(r, c, row, col, remaining_b);
+            uint64_t shared = mask_a & mask_b;
+            if (!shared) {
+                continue;
+            }
+            uint64_t only_a = mask_a & ~mask_b;
+            uint64_t only_b = mask_b & ~mask_a;
+            int size_shared = CountBits(shared);
+            int size_a = CountBits(only_a);
+            int size_b = CountBits(only_b);
+            //Bounds of the mines in the shared cells
+            int low = max({0, remaining_a - size_a, remaining_b - size_b});
+            int high = min({size_shared, remaining_a, remaining_b});
+            size_t known = safe.size() + mines.size();
+            if (only_a && remaining_a - low == 0) {
+                MarkMask(only_a, a, SOLVER_SAFE);
+            } else if (only_a && remaining_a - high == size_a) {
+                MarkMask(only_a, a, SOLVER_MINE);
+            }
+            if (only_b && remaining_b - low == 0) {
+                MarkMask(only_b, a, SOLVER_SAFE);
+            } else if (only_b && remaining_b - high == size_b) {
+                MarkMask(only_b, a, SOLVER_MINE);
+            }
+            if (high == 0) {
+                MarkMask(shared, a, SOLVER_SAFE);
+            } else if (low == size_shared) {
+                MarkMask(shared, a, SOLVER_MINE);
+            }
+            //The unknowns of this number changed, look at it again with the new state
+            if (safe.size() + mines.size() != known) {
+                Enqueue(a);
+                return;
+            }
+        }
+    }
+}
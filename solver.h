@@ -0,0 +1,62 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "logic.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * What the solver knows about a cell.
+ */
+enum SolverCell {
+    //Unopened and not deduced
+    SOLVER_UNKNOWN,
+    //Unopened and certainly safe
+    SOLVER_SAFE,
+    //Unopened and certainly a mine
+    SOLVER_MINE,
+    //Opened, its number is a constraint
+    SOLVER_OPENED,
+};
+
+/**
+ * Deterministic constraint propagation solver over the player-visible grid.
+ * Every opened number constrains its unopened neighbours; the solver applies the single-cell
+ * rules (all remaining mines placed / all unknown neighbours are mines) and the subset and
+ * overlap rule between pairs of numbers sharing unknown cells, until nothing new follows.
+ * Player flags are not trusted, only the solver's own mine deductions count.
+ * Work is incremental: Update only requeues the numbers around cells that changed.
+ */
+class Solver {
+public:
+    Solver(GridView);
+
+    void Update(const std::vector<int> &);
+    int Solve();
+
+    SolverCell Get(int) const;
+    const std::vector<int> &GetSafe() const;
+    const std::vector<int> &GetMines() const;
+
+private:
+    GridView view;
+    int height;
+    int width;
+    NeighbourTable neighbours;
+    std::vector<uint8_t> state;
+    //Opened numbers whose constraint changed since they were last examined
+    std::vector<int> queue;
+    std::vector<uint8_t> queued;
+    //Every deduction so far in the order found, flat indices
+    std::vector<int> safe;
+    std::vector<int> mines;
+
+    void Reveal(int index);
+    void Mark(int index, SolverCell knowledge);
+    void Enqueue(int index);
+    void Examine(int index);
+    uint64_t UnknownMask(int row, int col, int centre_row, int centre_col, int &remaining) const;
+    void MarkMask(uint64_t mask, int centre, SolverCell knowledge);
+};
+
+#endif
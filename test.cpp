@@ -0,0 +1,883 @@
+#include "countkernel.h"
+#include "logic.h"
+#include "noguess.h"
+#include "player.h"
+#include "probability.h"
+#include "protocol.h"
+#include "replay.h"
+#include "solver.h"
+#include <bitset>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Headless tests for the Board engine, built as minesweeper_test and run by ctest.
+ */
+
+static int failures = 0;
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures += 1;                                                        \
+        }                                                                         \
+    } while (0)
+
+/**
+ * @return FNV-1a hash of the raw cell store of a board
+ */
+template <typename B>
+uint64_t HashCells(B &board) {
+    const uint8_t *cells = board.GetView().Data();
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < board.GetHeight() * board.GetWidth(); i++) {
+        hash = (hash ^ cells[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @return true if cell at flat index holds a mine
+ */
+bool IsMine(Board &board, int index) {
+    return board.GetView().Data()[index] & Board::CELL_MINE;
+}
+
+/**
+ * @return flat index of the first safe 0 cell of a board, or -1 if there is none
+ */
+int FirstZeroCell(Board &board) {
+    const uint8_t *cells = board.GetView().Data();
+    for (int i = 0; i < board.GetHeight() * board.GetWidth(); i++) {
+        if ((cells[i] & (Board::CELL_MINE | Board::CELL_COUNT)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void TestPresets() {
+    Board easy{EASY, 1};
+    Board normal{NORMAL, 1};
+    Board hard{HARD, 1};
+    CHECK(easy.GetHeight() == 9 && easy.GetWidth() == 9 && easy.GetFlagsLeft() == 10);
+    CHECK(normal.GetHeight() == 16 && normal.GetWidth() == 16 && normal.GetFlagsLeft() == 40);
+    CHECK(hard.GetHeight() == 16 && hard.GetWidth() == 30 && hard.GetFlagsLeft() == 99);
+
+    //Invalid custom boards fall back to easy mode
+    Board invalid{4, 4, 16, 1};
+    CHECK(invalid.GetHeight() == 9 && invalid.GetWidth() == 9 && invalid.GetFlagsLeft() == 10);
+}
+
+void TestSeedReproducible() {
+    Board a{HARD, 42};
+    Board b{HARD, 42};
+    Board c{HARD, 43};
+    CHECK(a.GetSeed() == 42);
+    CHECK(HashCells(a) == HashCells(b));
+    CHECK(HashCells(a) != HashCells(c));
+
+    //Pinned layout, must not change between platforms or releases
+    CHECK(HashCells(a) == 0xc801770fd43b5c12ULL);
+
+    //Both the sparse and the dense sampling place exactly bomb_size mines
+    for (int bombs : {1, 50, 99, 150, 199}) {
+        Board board{10, 20, (uint32_t)bombs, 7};
+        int count = 0;
+        for (int i = 0; i < 200; i++) {
+            count += IsMine(board, i);
+        }
+        CHECK(count == bombs);
+    }
+}
+
+void TestLargeSparseCascade() {
+    //One mine, a single Open reveals every other cell without recursing
+    Board board{2048, 2048, 1, 3};
+    int mine = 0;
+    while (!IsMine(board, mine)) {
+        mine += 1;
+    }
+    int start = mine == 0 ? 2048 * 2048 - 1 : 0;
+    CHECK(board.Open(start / 2048, start % 2048) == WON);
+    CHECK((int)board.GetChanges().size() == 2048 * 2048 - 1);
+}
+
+void TestChord() {
+    Board board{HARD, 5};
+    GridView view = board.GetView();
+    int width = board.GetWidth();
+    //Open the first safe 0 cell to get a numbered border
+    int start = 0;
+    while (IsMine(board, start) || (view.Data()[start] & Board::CELL_COUNT)) {
+        start += 1;
+    }
+    board.Open(start / width, start % width);
+    //Find an opened numbered cell with an unopened neighbour
+    for (int index = 0; index < board.GetHeight() * width; index++) {
+        int value = view.At(index);
+        if (value < 1 || value > 8) {
+            continue;
+        }
+        int row = index / width;
+        int col = index % width;
+        vector<int> neighbours;
+        for (int r = max(row - 1, 0); r <= min(row + 1, board.GetHeight() - 1); r++) {
+            for (int c = max(col - 1, 0); c <= min(col + 1, width - 1); c++) {
+                if (r != row || c != col) {
+                    neighbours.push_back(r * width + c);
+                }
+            }
+        }
+        int unopened = 0;
+        for (int n : neighbours) {
+            unopened += view.At(n) == 10;
+        }
+        if (unopened == 0) {
+            continue;
+        }
+        //Flag the mines around it, then chord
+        for (int n : neighbours) {
+            if (IsMine(board, n)) {
+                board.Flag(n / width, n % width);
+            }
+        }
+        int moves = board.GetMoves();
+        CHECK(board.Open(row, col) != LOST);
+        CHECK(board.GetMoves() == moves + 1);
+        for (int n : neighbours) {
+            CHECK(view.At(n) != 10);
+        }
+        //Chording again opens nothing and is not counted
+        board.Open(row, col);
+        CHECK(board.GetMoves() == moves + 1);
+        return;
+    }
+    CHECK(false);
+}
+
+void TestRandomPlay() {
+    //Change lists match snapshot diffs, and the live counters and win check match a full scan
+    Xoshiro256 gen{11};
+    for (int game = 0; game < 3000; game++) {
+        int height = 1 + gen() % 40;
+        int width = 2 + gen() % 40;
+        int bombs = 1 + gen() % (height * width / 5 + 1);
+        Board board{(uint16_t)height, (uint16_t)width, (uint32_t)bombs, (uint64_t)game};
+        vector<vector<int>> before = board.GetPlayerGrid();
+        GameState state = PLAYING;
+        while (state == PLAYING) {
+            int row = gen() % height;
+            int col = gen() % width;
+            if (gen() % 3 == 0) {
+                board.Flag(row, col);
+            } else {
+                state = board.Open(row, col);
+            }
+            vector<vector<int>> after = board.GetPlayerGrid();
+            set<int> diff;
+            int hidden = 0;
+            for (int i = 0; i < height; i++) {
+                for (int j = 0; j < width; j++) {
+                    if (after[i][j] != before[i][j]) {
+                        diff.insert(i * width + j);
+                    }
+                    hidden += after[i][j] >= 10;
+                }
+            }
+            const vector<int> &changes = board.GetChanges();
+            CHECK(set<int>(changes.begin(), changes.end()) == diff && changes.size() == diff.size());
+            CHECK(board.CountersMatch());
+            if (state != LOST) {
+                CHECK((state == WON) == (hidden == bombs));
+            }
+            before = after;
+        }
+    }
+}
+
+/**
+ * Visible state of a board, compared by TestUndo
+ */
+struct Snapshot {
+    vector<vector<int>> grid;
+    int flags_left;
+    int moves;
+    GameState state;
+
+    bool operator==(const Snapshot &other) const {
+        return grid == other.grid && flags_left == other.flags_left && moves == other.moves && state == other.state;
+    }
+};
+
+Snapshot TakeSnapshot(Board &board) {
+    return {board.GetPlayerGrid(), board.GetFlagsLeft(), board.GetMoves(), board.GetState()};
+}
+
+/**
+ * @return true if the change list of the last move holds exactly the cells that differ
+ */
+bool ChangesMatch(Board &board, const Snapshot &before, const Snapshot &after) {
+    set<int> diff;
+    int width = board.GetWidth();
+    for (int i = 0; i < board.GetHeight(); i++) {
+        for (int j = 0; j < width; j++) {
+            if (after.grid[i][j] != before.grid[i][j]) {
+                diff.insert(i * width + j);
+            }
+        }
+    }
+    const vector<int> &changes = board.GetChanges();
+    return set<int>(changes.begin(), changes.end()) == diff && changes.size() == diff.size();
+}
+
+void TestUndo() {
+    //Undoing every move walks back through the same states, redoing walks forward again
+    Xoshiro256 gen{13};
+    for (int game = 0; game < 1000; game++) {
+        int height = 1 + gen() % 20;
+        int width = 2 + gen() % 20;
+        int bombs = 1 + gen() % (height * width / 5 + 1);
+        Board board{(uint16_t)height, (uint16_t)width, (uint32_t)bombs, (uint64_t)game, (FirstClick)(game % 3)};
+        board.EnableJournal();
+        //State right after each journaled move, and the same state updated by the moves that
+        //followed without changing anything, which are not journaled but may still count
+        vector<Snapshot> played = {TakeSnapshot(board)};
+        vector<Snapshot> history = played;
+        GameState state = PLAYING;
+        while (state == PLAYING) {
+            int row = gen() % height;
+            int col = gen() % width;
+            if (gen() % 3 == 0) {
+                board.Flag(row, col);
+            } else {
+                state = board.Open(row, col);
+            }
+            if (board.GetChanges().empty()) {
+                history.back() = TakeSnapshot(board);
+            } else {
+                played.push_back(TakeSnapshot(board));
+                history.push_back(played.back());
+            }
+        }
+        CHECK(!board.Redo());
+        for (size_t k = history.size() - 1; k > 0; k--) {
+            CHECK(board.Undo());
+            Snapshot now = TakeSnapshot(board);
+            CHECK(now == history[k - 1] && ChangesMatch(board, history[k], now) && board.CountersMatch());
+        }
+        CHECK(!board.Undo());
+        for (size_t k = 1; k < played.size(); k++) {
+            CHECK(board.Redo());
+            Snapshot now = TakeSnapshot(board);
+            CHECK(now == played[k] && ChangesMatch(board, played[k - 1], now) && board.CountersMatch());
+        }
+        //A new move after undoing drops the undone moves
+        CHECK(board.Undo());
+        if (board.GetView().At(0) == 10) {
+            board.Flag(0, 0);
+            CHECK(!board.Redo());
+        }
+    }
+
+    //Without the journal there is nothing to undo
+    Board plain{EASY, 5};
+    plain.Open(0, 0);
+    plain.Flag(8, 8);
+    CHECK(!plain.Undo() && !plain.Redo());
+
+    //Undoing a large cascade is proportional to the cells it revealed
+    Board board{1024, 1024, 1, 3};
+    board.EnableJournal();
+    int start = FirstZeroCell(board);
+    board.Open(start / 1024, start % 1024);
+    CHECK(board.GetChanges().size() == 1024 * 1024 - 1);
+    CHECK(board.Undo() && board.GetChanges().size() == 1024 * 1024 - 1 && board.GetView().At(start) == 10);
+    CHECK(board.Redo() && board.GetState() == WON);
+}
+
+/**
+ * @return contents of a file
+ */
+string ReadFile(const string &path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void WriteFile(const string &path, const string &data) {
+    ofstream out(path, ios::binary | ios::trunc);
+    out << data;
+}
+
+void TestSaveLoad() {
+    //Saved games load back to the same position and keep playing the same way, damaged saves
+    //are rejected and leave the board untouched
+    const string path = "minesweeper_test.sav";
+    Xoshiro256 gen{17};
+    for (int game = 0; game < 500; game++) {
+        int height = 1 + gen() % 70;
+        int width = 2 + gen() % 70;
+        int bombs = 1 + gen() % (height * width / 4 + 1);
+        Board board{(uint16_t)height, (uint16_t)width, (uint32_t)bombs, (uint64_t)game, (FirstClick)(game % 3)};
+        int played = gen() % 40;
+        for (int move = 0; move < played && board.GetState() == PLAYING; move++) {
+            if (gen() % 3 == 0) {
+                board.Flag(gen() % height, gen() % width);
+            } else {
+                board.Open(gen() % height, gen() % width);
+            }
+        }
+        uint32_t elapsed = gen() % 100000;
+        CHECK(board.Save(path, elapsed));
+
+        Board loaded{EASY, 0};
+        uint32_t loaded_elapsed = 0;
+        CHECK(loaded.Load(path, loaded_elapsed) && loaded_elapsed == elapsed);
+        CHECK(HashCells(loaded) == HashCells(board) && loaded.GetSeed() == board.GetSeed() && loaded.CountersMatch());
+        CHECK(loaded.GetFlagsLeft() == board.GetFlagsLeft() && loaded.GetMoves() == board.GetMoves() && loaded.GetState() == board.GetState());
+        for (int move = 0; move < 20; move++) {
+            int row = gen() % height;
+            int col = gen() % width;
+            CHECK(loaded.Open(row, col) == board.Open(row, col) && HashCells(loaded) == HashCells(board));
+        }
+
+        //Any flipped byte or missing tail is caught
+        string data = ReadFile(path);
+        string damaged = data;
+        damaged[gen() % damaged.size()] ^= 1 << (gen() % 8);
+        WriteFile(path, damaged);
+        uint64_t hash = HashCells(loaded);
+        CHECK(!loaded.Load(path, loaded_elapsed) && HashCells(loaded) == hash);
+        WriteFile(path, data.substr(0, gen() % data.size()));
+        CHECK(!loaded.Load(path, loaded_elapsed) && HashCells(loaded) == hash);
+    }
+
+    //Fixed boards load games of their own size only
+    Board hard{HARD, 7};
+    hard.Open(8, 15);
+    CHECK(hard.Save(path, 1234));
+    HardBoard fixed{1};
+    EasyBoard easy{1};
+    uint32_t elapsed = 0;
+    CHECK(fixed.Load(path, elapsed) && elapsed == 1234 && HashCells(fixed) == HashCells(hard));
+    CHECK(!easy.Load(path, elapsed));
+    remove(path.c_str());
+    CHECK(!fixed.Load(path, elapsed));
+}
+
+void TestReplay() {
+    //Recorded games encode and decode losslessly and verify, altered claims or moves do not
+    Xoshiro256 gen{19};
+    vector<uint8_t> corpus;
+    vector<Replay> replays;
+    for (int game = 0; game < 500; game++) {
+        Replay replay;
+        replay.height = 1 + gen() % 30;
+        replay.width = 2 + gen() % 30;
+        replay.mines = 1 + gen() % (replay.height * replay.width / 5 + 1);
+        replay.seed = gen();
+        replay.first_click = (FirstClick)(game % 3);
+        if (game % 50 == 0) {
+            replay.height = 16;
+            replay.width = 30;
+            replay.mines = 99;
+        }
+        Board board{replay.height, replay.width, replay.mines, replay.seed, replay.first_click};
+        uint32_t time = 0;
+        while (board.GetState() == PLAYING) {
+            int index = gen() % (replay.height * replay.width);
+            ReplayAction action = gen() % 4 == 0 ? REPLAY_FLAG : REPLAY_OPEN;
+            time += gen() % 3000;
+            replay.moves.push_back({time, action, index});
+            if (action == REPLAY_OPEN) {
+                board.Open(index / replay.width, index % replay.width);
+            } else {
+                board.Flag(index / replay.width, index % replay.width);
+            }
+        }
+        replay.result = board.GetState();
+        replay.duration = time;
+        CHECK(VerifyReplay(replay));
+        EncodeReplay(replay, corpus);
+        replays.push_back(replay);
+
+        Replay altered = replay;
+        altered.result = replay.result == WON ? LOST : WON;
+        CHECK(!VerifyReplay(altered));
+        altered = replay;
+        altered.duration += 1;
+        CHECK(!VerifyReplay(altered));
+        altered = replay;
+        altered.moves.pop_back();
+        CHECK(!VerifyReplay(altered));
+        altered = replay;
+        altered.moves.push_back({time, REPLAY_OPEN, 0});
+        CHECK(!VerifyReplay(altered));
+    }
+
+    //Concatenated replays decode one after another, truncated ones are rejected
+    size_t at = 0;
+    for (const Replay &expected : replays) {
+        Replay replay;
+        size_t used = DecodeReplay(&corpus[at], corpus.size() - at, replay);
+        CHECK(used > 0 && VerifyReplay(replay));
+        CHECK(replay.seed == expected.seed && replay.result == expected.result && replay.duration == expected.duration);
+        bool same = replay.moves.size() == expected.moves.size();
+        for (size_t i = 0; same && i < replay.moves.size(); i++) {
+            same = replay.moves[i].time == expected.moves[i].time && replay.moves[i].action == expected.moves[i].action &&
+                   replay.moves[i].index == expected.moves[i].index;
+        }
+        CHECK(same);
+        Replay truncated;
+        CHECK(DecodeReplay(&corpus[at], used - 1, truncated) == 0);
+        at += used;
+    }
+    CHECK(at == corpus.size());
+
+    //Seeking through keyframes reaches the same position as playing from the start
+    ReplaySeeker seeker;
+    for (size_t r = 0; r < replays.size(); r += 10) {
+        const Replay &replay = replays[r];
+        vector<uint8_t> data;
+        int interval = 1 + r % 5;
+        EncodeReplay(replay, data, interval);
+        CHECK(seeker.Open(data.data(), data.size()));
+        CHECK(seeker.GetKeyframeCount() >= (int)replay.moves.size() / interval);
+        Board seeked{EASY, 0};
+        for (int trial = 0; trial < 5; trial++) {
+            int target = gen() % (replay.moves.size() + 1);
+            Board played{replay.height, replay.width, replay.mines, replay.seed, replay.first_click};
+            for (int i = 0; i < target; i++) {
+                int index = replay.moves[i].index;
+                if (replay.moves[i].action == REPLAY_OPEN) {
+                    played.Open(index / replay.width, index % replay.width);
+                } else {
+                    played.Flag(index / replay.width, index % replay.width);
+                }
+            }
+            CHECK(seeker.Seek(seeked, target));
+            CHECK(HashCells(seeked) == HashCells(played) && seeked.GetState() == played.GetState());
+            CHECK(seeked.GetFlagsLeft() == played.GetFlagsLeft() && seeked.GetMoves() == played.GetMoves());
+        }
+        //Keyframes do not change what the replay decodes to
+        Replay decoded;
+        CHECK(DecodeReplay(data.data(), data.size(), decoded) == data.size() && VerifyReplay(decoded));
+    }
+
+    const string path = "minesweeper_test.replay";
+    Replay loaded;
+    CHECK(SaveReplay(replays[0], path) && LoadReplay(path, loaded) && VerifyReplay(loaded));
+    remove(path.c_str());
+    CHECK(!LoadReplay(path, loaded));
+}
+
+/**
+ * @return reply of the protocol engine to one command
+ */
+string Reply(ProtocolEngine &engine, const string &command) {
+    ostringstream out;
+    engine.Execute(command, out);
+    return out.str();
+}
+
+void TestProtocol() {
+    //Move replies list the changed cells of the same game played on a Board
+    ProtocolEngine engine;
+    CHECK(Reply(engine, "open 0 0").compare(0, 6, "error ") == 0);
+    CHECK(Reply(engine, "new hard 42") == "ok 16 30 99 42\n");
+    Board board{HARD, 42};
+    GridView view = board.GetView();
+    Xoshiro256 gen{23};
+    while (board.GetState() == PLAYING) {
+        int row = gen() % 16;
+        int col = gen() % 30;
+        string command;
+        if (gen() % 4 == 0) {
+            command = "flag";
+            board.Flag(row, col);
+        } else {
+            command = view.At(row, col) < 9 ? "chord" : "open";
+            board.Open(row, col);
+        }
+        ostringstream expected;
+        expected << (board.GetState() == PLAYING ? "playing" : board.GetState() == WON ? "won" : "lost") << ' ' << board.GetChanges().size();
+        for (int index : board.GetChanges()) {
+            expected << ' ' << index / 30 << ' ' << index % 30 << ' ' << "012345678*.F"[view.At(index)];
+        }
+        expected << '\n';
+        CHECK(Reply(engine, command + " " + to_string(row) + " " + to_string(col)) == expected.str());
+        CHECK(Reply(engine, "delta") == expected.str());
+    }
+    string state = Reply(engine, "state");
+    CHECK(state.size() == 4 + 1 + to_string(board.GetFlagsLeft()).size() + 1 + to_string(board.GetMoves()).size() + 1 + 16 * 30 + 1);
+
+    //Moves after a win or a loss are refused and leave the result as it was
+    int lost_seed = 0;
+    while (Board{2, 2, 3, (uint64_t)lost_seed}.Open(0, 0) != LOST) {
+        lost_seed++;
+    }
+    const string finished[][2] = {{"new 1 2 1 5 safe", "won 1 "}, {"new 2 2 3 " + to_string(lost_seed), "lost "}};
+    for (const auto &game : finished) {
+        Reply(engine, game[0]);
+        CHECK(Reply(engine, "open 0 0").compare(0, game[1].size(), game[1]) == 0);
+        string final_state = Reply(engine, "state");
+        for (const string move : {"open 0 1", "flag 0 1", "chord 0 0", "open 0 0"}) {
+            CHECK(Reply(engine, move) == "error game over\n");
+        }
+        CHECK(Reply(engine, "state") == final_state && Reply(engine, "delta").compare(0, game[1].size(), game[1]) == 0);
+    }
+
+    CHECK(Reply(engine, "new 3 3 1 5 opening") == "ok 3 3 1 5\n");
+    CHECK(Reply(engine, "chord 1 1") == "playing 0\n");
+    CHECK(Reply(engine, "open 3 0").compare(0, 6, "error ") == 0);
+    CHECK(Reply(engine, "new 3 3 1 5 sometimes").compare(0, 6, "error ") == 0);
+    CHECK(Reply(engine, "jump").compare(0, 6, "error ") == 0);
+    ostringstream out;
+    CHECK(!engine.Execute("quit", out) && out.str().empty());
+}
+
+void TestCountKernels() {
+    Xoshiro256 gen{1};
+    for (int trial = 0; trial < 50; trial++) {
+        int height = 1 + gen() % 40;
+        int width = 1 + gen() % 600;
+        int words = (width + 63) / 64;
+        vector<uint64_t> mines(height * words, 0);
+        auto is_mine = [&](int r, int c) {
+            return r >= 0 && r < height && c >= 0 && c < width && (mines[r * words + c / 64] >> (c % 64) & 1);
+        };
+        for (int r = 0; r < height; r++) {
+            for (int c = 0; c < width; c++) {
+                if (gen() % 3 == 0) {
+                    mines[r * words + c / 64] |= 1ULL << (c % 64);
+                }
+            }
+        }
+        for (int kernel = KERNEL_SCALAR; kernel <= SelectCountKernel(); kernel++) {
+            vector<uint8_t> cells(height * width);
+            CountNeighbourMines(mines.data(), height, width, Board::CELL_MINE, cells.data(), (CountKernel)kernel);
+            bool correct = true;
+            for (int r = 0; r < height; r++) {
+                for (int c = 0; c < width; c++) {
+                    int count = 0;
+                    for (int dr = -1; dr <= 1; dr++) {
+                        for (int dc = -1; dc <= 1; dc++) {
+                            count += (dr || dc) && is_mine(r + dr, c + dc);
+                        }
+                    }
+                    correct &= cells[r * width + c] == (count | (is_mine(r, c) ? Board::CELL_MINE : 0));
+                }
+            }
+            CHECK(correct);
+        }
+    }
+}
+
+void TestSolver() {
+    //Deductions are sound, and updating incrementally reaches the same result as a fresh solve
+    int wins = 0;
+    for (int game = 0; game < 600; game++) {
+        Board board{(Level)(game % 3), (uint64_t)game};
+        GridView view = board.GetView();
+        int width = board.GetWidth();
+        Solver solver{view};
+        int start = FirstZeroCell(board);
+        GameState state = board.Open(start / width, start % width);
+        solver.Update(board.GetChanges());
+        size_t next = 0;
+        while (state == PLAYING) {
+            solver.Solve();
+            if (next == solver.GetSafe().size()) {
+                break;
+            }
+            for (; next < solver.GetSafe().size() && state == PLAYING; next++) {
+                int index = solver.GetSafe()[next];
+                CHECK(!IsMine(board, index));
+                if (view.At(index) == 10) {
+                    state = board.Open(index / width, index % width);
+                    solver.Update(board.GetChanges());
+                }
+            }
+        }
+        CHECK(state != LOST);
+        wins += state == WON;
+        for (int index : solver.GetMines()) {
+            CHECK(IsMine(board, index));
+        }
+        if (state == PLAYING) {
+            Solver fresh{view};
+            fresh.Solve();
+            bool same = true;
+            for (int i = 0; i < board.GetHeight() * width; i++) {
+                same &= fresh.Get(i) == solver.Get(i);
+            }
+            CHECK(same);
+        }
+    }
+    //Most EASY and NORMAL games need no guess after a 0 cell start
+    CHECK(wins > 200);
+}
+
+void TestProbabilities() {
+    //Exact probabilities match brute force enumeration of every layout agreeing with the grid
+    Xoshiro256 gen{5};
+    ProbabilityEngine engine;
+    int checked = 0;
+    for (int game = 0; game < 300; game++) {
+        int height = 3 + gen() % 4;
+        int width = 3 + gen() % 4;
+        int bombs = 2 + gen() % 5;
+        Board board{(uint16_t)height, (uint16_t)width, (uint32_t)bombs, (uint64_t)game};
+        GridView view = board.GetView();
+        int cells = height * width;
+        //Open a few safe cells and flag a mine
+        for (int i = 0, opened = 0; i < cells && opened < 2; i++) {
+            int index = gen() % cells;
+            if (!IsMine(board, index) && view.At(index) == 10) {
+                board.Open(index / width, index % width);
+                opened += 1;
+            }
+        }
+        for (int i = 0; i < cells; i++) {
+            if (IsMine(board, i) && gen() % 3 == 0) {
+                board.Flag(i / width, i % width);
+                break;
+            }
+        }
+        vector<int> unknown;
+        for (int i = 0; i < cells; i++) {
+            if (view.At(i) == 10) {
+                unknown.push_back(i);
+            }
+        }
+        if (unknown.size() > 20) {
+            continue;
+        }
+        CHECK(engine.Compute(view, board.GetFlagsLeft()));
+
+        NeighbourTable neighbours{height, width};
+        vector<double> mine_count(cells, 0);
+        double layouts = 0;
+        vector<uint8_t> mine(cells, 0);
+        for (uint32_t subset = 0; subset < (1u << unknown.size()); subset++) {
+            if ((int)bitset<32>(subset).count() != board.GetFlagsLeft()) {
+                continue;
+            }
+            for (int i = 0; i < cells; i++) {
+                mine[i] = view.At(i) == 11;
+            }
+            for (size_t u = 0; u < unknown.size(); u++) {
+                mine[unknown[u]] = subset >> u & 1;
+            }
+            bool agrees = true;
+            for (int i = 0; i < cells && agrees; i++) {
+                if (view.At(i) <= 8) {
+                    int count = 0;
+                    neighbours.ForEach(i, [&](int n) {
+                        count += mine[n];
+                    });
+                    agrees = count == view.At(i);
+                }
+            }
+            if (agrees) {
+                layouts += 1;
+                for (int i = 0; i < cells; i++) {
+                    mine_count[i] += mine[i];
+                }
+            }
+        }
+        bool same = true;
+        for (int i = 0; i < cells; i++) {
+            same &= fabs(engine.GetProbabilities()[i] - mine_count[i] / layouts) < 1e-9;
+        }
+        CHECK(same);
+        checked += 1;
+    }
+    CHECK(checked > 100);
+
+    //Flagging more cells than a number allows leaves no layout at all
+    Board board{EASY, 2};
+    GridView view = board.GetView();
+    int start = FirstZeroCell(board);
+    board.Open(start / 9, start % 9);
+    CHECK(engine.Compute(view, board.GetFlagsLeft()));
+    NeighbourTable neighbours{9, 9};
+    for (int i = 0; i < 81; i++) {
+        vector<int> unknown;
+        neighbours.ForEach(i, [&](int n) {
+            if (view.At(n) == 10) {
+                unknown.push_back(n);
+            }
+        });
+        if (view.At(i) <= 8 && (int)unknown.size() > view.At(i)) {
+            for (int n = 0; n <= view.At(i); n++) {
+                board.Flag(unknown[n] / 9, unknown[n] % 9);
+            }
+            CHECK(!engine.Compute(view, board.GetFlagsLeft()));
+            return;
+        }
+    }
+    CHECK(false);
+}
+
+void TestPlayer() {
+    //Play is deterministic, and never loses when it may not guess
+    Player player;
+    int wins = 0;
+    for (int game = 0; game < 300; game++) {
+        Board a{(Level)(game % 3), (uint64_t)game};
+        Board b{(Level)(game % 3), (uint64_t)game};
+        GameState state = player.Play(a);
+        int guesses = player.GetGuesses();
+        CHECK(player.Play(b) == state && player.GetGuesses() == guesses && HashCells(a) == HashCells(b));
+        CHECK(guesses >= 1);
+        wins += state == WON;
+
+        Board c{(Level)(game % 3), (uint64_t)game};
+        int start = FirstZeroCell(c);
+        c.Open(start / c.GetWidth(), start % c.GetWidth());
+        CHECK(player.Play(c, false) != LOST && player.GetGuesses() == 0);
+    }
+    CHECK(wins > 50);
+}
+
+void TestNoGuess() {
+    //The result does not depend on the thread count and clears without a guess
+    NoGuessGenerator one{1};
+    NoGuessGenerator three{3};
+    for (int level = EASY; level <= HARD; level++) {
+        Board preset{(Level)level, 0};
+        int height = preset.GetHeight();
+        int width = preset.GetWidth();
+        for (uint64_t seed = 0; seed < 3; seed++) {
+            NoGuessResult a = one.Generate(height, width, preset.GetFlagsLeft(), height / 2, width / 2, seed, 60000);
+            NoGuessResult b = three.Generate(height, width, preset.GetFlagsLeft(), height / 2, width / 2, seed, 60000);
+            CHECK(a.no_guess && b.no_guess && a.seed == b.seed);
+            Board board{(Level)level, a.seed};
+            Player player;
+            CHECK(board.Open(height / 2, width / 2) != LOST);
+            CHECK(player.Play(board, false) == WON);
+        }
+    }
+
+    //Opening first clicks give the same no-guess result for any thread count
+    NoGuessResult a = one.Generate(16, 30, 99, 0, 0, 5, 60000, FIRST_CLICK_OPENING);
+    NoGuessResult b = three.Generate(16, 30, 99, 0, 0, 5, 60000, FIRST_CLICK_OPENING);
+    CHECK(a.no_guess && a.seed == b.seed);
+    Board opening{HARD, a.seed, FIRST_CLICK_OPENING};
+    Player player;
+    CHECK(opening.Open(0, 0) != LOST && player.Play(opening, false) == WON);
+
+    //Without any time the search falls back to a board that may need guessing
+    NoGuessResult timeout = three.Generate(16, 30, 99, 8, 15, 1, 0);
+    CHECK(!timeout.no_guess);
+}
+
+void TestFirstClick() {
+    //Deferred placement never loses on the first click and stays reproducible
+    Xoshiro256 gen{9};
+    for (int game = 0; game < 2000; game++) {
+        int height = 1 + gen() % 20;
+        int width = 2 + gen() % 20;
+        int bombs = 1 + gen() % (height * width - 1);
+        FirstClick rule = game % 2 ? FIRST_CLICK_SAFE : FIRST_CLICK_OPENING;
+        int row = gen() % height;
+        int col = gen() % width;
+        Board a{(uint16_t)height, (uint16_t)width, (uint32_t)bombs, (uint64_t)game, rule};
+        Board b{(uint16_t)height, (uint16_t)width, (uint32_t)bombs, (uint64_t)game, rule};
+        int mines = 0;
+        for (int i = 0; i < height * width; i++) {
+            mines += IsMine(a, i);
+        }
+        CHECK(mines == 0);
+        CHECK(a.Open(row, col) != LOST);
+        b.Open(row, col);
+        CHECK(HashCells(a) == HashCells(b));
+        for (int i = 0; i < height * width; i++) {
+            mines += IsMine(a, i);
+        }
+        CHECK(mines == bombs);
+        //The area opens whenever there is room to spare the neighbours
+        if (rule == FIRST_CLICK_OPENING && bombs <= height * width - 9) {
+            CHECK(a.GetView().At(row, col) == 0);
+        }
+    }
+
+    //Flags set before the first click survive the placement
+    Board board{HARD, 3, FIRST_CLICK_OPENING};
+    board.Flag(0, 0);
+    board.Flag(15, 29);
+    CHECK(board.GetFlagsLeft() == 97);
+    CHECK(board.Open(8, 15) != LOST);
+    CHECK(board.GetView().At(0, 0) == 11 && board.GetView().At(15, 29) == 11);
+    CHECK(board.GetFlagsLeft() == 97);
+    //Unflagging one keeps the counters and the win check consistent
+    board.Flag(0, 0);
+    Player player;
+    GameState state = player.Play(board);
+    CHECK(state != PLAYING);
+
+    //Any first click keeps the layouts of eager placement
+    Board eager{HARD, 42, FIRST_CLICK_ANY};
+    CHECK(HashCells(eager) == 0xc801770fd43b5c12ULL);
+}
+
+/**
+ * Plays the same games on a fixed preset board and on Board
+ */
+template <typename B>
+void CheckFixedBoard(Level level) {
+    Player player;
+    for (int game = 0; game < 200; game++) {
+        FirstClick rule = (FirstClick)(game % 3);
+        B fixed{(uint64_t)game, rule};
+        Board dynamic{level, (uint64_t)game, rule};
+        CHECK(fixed.GetHeight() == dynamic.GetHeight() && fixed.GetWidth() == dynamic.GetWidth());
+        CHECK(fixed.GetFlagsLeft() == dynamic.GetFlagsLeft());
+        CHECK(HashCells(fixed) == HashCells(dynamic));
+        GameState state = player.Play(fixed);
+        int guesses = player.GetGuesses();
+        CHECK(player.Play(dynamic) == state && player.GetGuesses() == guesses);
+        CHECK(fixed.GetMoves() == dynamic.GetMoves() && HashCells(fixed) == HashCells(dynamic));
+        CHECK(fixed.GetChanges() == dynamic.GetChanges());
+    }
+}
+
+void TestFixedBoards() {
+    //Compile-time preset boards give the same layouts and games as Board
+    CheckFixedBoard<EasyBoard>(EASY);
+    CheckFixedBoard<NormalBoard>(NORMAL);
+    CheckFixedBoard<HardBoard>(HARD);
+}
+
+int main() {
+    TestPresets();
+    TestSeedReproducible();
+    TestLargeSparseCascade();
+    TestChord();
+    TestRandomPlay();
+    TestUndo();
+    TestSaveLoad();
+    TestReplay();
+    TestProtocol();
+    TestCountKernels();
+    TestSolver();
+    TestProbabilities();
+    TestPlayer();
+    TestNoGuess();
+    TestFirstClick();
+    TestFixedBoards();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All tests passed\n");
+    return 0;
+}
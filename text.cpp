@@ -0,0 +1,156 @@
+#ifndef TEXT_CPP
+#define TEXT_CPP
+
+#include "texture.cpp"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+/**
+ * Text renderer drawing strings as copies from a texture holding every printable ASCII glyph,
+ * rasterised once. Text is drawn white in the atlas and tinted with SDL_SetTextureColorMod, so
+ * changing numbers such as the timer cost no font rendering or texture uploads.
+ */
+class GlyphAtlas {
+public:
+    GlyphAtlas();
+
+    bool Load(TTF_Font *, SDL_Renderer *);
+    void Render(SDL_Renderer *, const std::string &, int, int, const SDL_Color &);
+    void Free();
+
+    int GetWidth(const std::string &);
+    int GetHeight();
+
+private:
+    const static char first_glyph = ' ';
+    const static char last_glyph = '~';
+
+    Texture atlas_texture;
+    SDL_Rect glyph_clips[last_glyph - first_glyph + 1];
+    int m_height;
+
+    const SDL_Rect *GetClip(char);
+};
+
+/**
+ * Default Constructor. Empty until Load.
+ */
+GlyphAtlas::GlyphAtlas() : glyph_clips{}, m_height{0} {}
+
+/**
+ * Rasterises the printable ASCII glyphs of font side by side into one texture
+ * @param g_font font of text
+ * @param g_renderer used for rendering
+ * @return true on success, false otherwise
+ */
+bool GlyphAtlas::Load(TTF_Font *g_font, SDL_Renderer *g_renderer) {
+    Free();
+    const SDL_Color white{255, 255, 255, 255};
+    SDL_Surface *glyphs[last_glyph - first_glyph + 1];
+    int width = 0;
+    m_height = TTF_FontHeight(g_font);
+    for (char c = first_glyph; c <= last_glyph; c++) {
+        const int i = c - first_glyph;
+        const char text[2] = {c, '\0'};
+        //Blank glyphs (space) have no surface, only an advance
+        glyphs[i] = TTF_RenderText_Blended(g_font, text, white);
+        int advance = 0;
+        if (glyphs[i] != NULL) {
+            advance = glyphs[i]->w;
+            m_height = std::max(m_height, glyphs[i]->h);
+        } else {
+            TTF_GlyphMetrics(g_font, c, NULL, NULL, NULL, NULL, &advance);
+        }
+        glyph_clips[i] = SDL_Rect{width, 0, advance, 0};
+        width += advance;
+    }
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, std::max(width, 1), std::max(m_height, 1), 32, SDL_PIXELFORMAT_RGBA32);
+    bool success = atlas != NULL;
+    if (!success) {
+        printf("Unable to create glyph atlas! SDL Error: %s\n", SDL_GetError());
+    }
+    for (int i = 0; i <= last_glyph - first_glyph; i++) {
+        glyph_clips[i].h = m_height;
+        if (glyphs[i] != NULL) {
+            if (success) {
+                //Copy coverage as is rather than blending it onto the empty atlas
+                SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+                SDL_Rect dest = glyph_clips[i];
+                SDL_BlitSurface(glyphs[i], NULL, atlas, &dest);
+            }
+            SDL_FreeSurface(glyphs[i]);
+        }
+    }
+    if (success) {
+        success = atlas_texture.LoadFromSurface(g_renderer, atlas);
+        SDL_FreeSurface(atlas);
+    }
+    return success;
+}
+
+/**
+ * Renders text with its top left corner at (x, y). Characters outside printable ASCII are skipped.
+ * @param g_renderer renderer to be loaded to
+ * @param text text to be shown
+ * @param x x coordinate of rendering destination
+ * @param y y coordinate of rendering destination
+ * @param color color of text
+ */
+void GlyphAtlas::Render(SDL_Renderer *g_renderer, const std::string &text, int x, int y, const SDL_Color &color) {
+    atlas_texture.SetColor(color);
+    for (char c : text) {
+        const SDL_Rect *clip = GetClip(c);
+        if (clip == NULL) {
+            continue;
+        }
+        if (c != ' ') {
+            const SDL_Rect dest{x, y, clip->w, clip->h};
+            atlas_texture.Render(g_renderer, clip, &dest);
+        }
+        x += clip->w;
+    }
+}
+
+/**
+ * Deallocates memory.
+ */
+void GlyphAtlas::Free() {
+    atlas_texture.Free();
+}
+
+/**
+ * @param text text to be measured
+ * @return width of text when rendered
+ */
+int GlyphAtlas::GetWidth(const std::string &text) {
+    int width = 0;
+    for (char c : text) {
+        const SDL_Rect *clip = GetClip(c);
+        if (clip != NULL) {
+            width += clip->w;
+        }
+    }
+    return width;
+}
+
+/**
+ * @return height of a line of text
+ */
+int GlyphAtlas::GetHeight() {
+    return m_height;
+}
+
+/**
+ * @return clip of glyph c in the atlas, or NULL if not in the atlas
+ */
+const SDL_Rect *GlyphAtlas::GetClip(char c) {
+    if (c < first_glyph || c > last_glyph) {
+        return NULL;
+    }
+    return &glyph_clips[c - first_glyph];
+}
+
+#endif
\ No newline at end of file
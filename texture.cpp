@@ -1,9 +1,9 @@
 #ifndef TEXTURE_CPP
 #define TEXTURE_CPP
 
-#include <SDL2\SDL.h>
-#include <SDL2\SDL_image.h>
-#include <SDL2\SDL_ttf.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
 #include <iostream>
 
 /**
@@ -14,15 +14,22 @@ public:
     Texture();
     ~Texture();
 
-    bool LoadFromFile(SDL_Renderer *, const std::string &);
-    bool LoadFromRenderedText(TTF_Font *, SDL_Renderer *, const std::string &, const SDL_Color *, const SDL_Color *bg_color = NULL);
+    bool LoadScaledTiles(SDL_Renderer *, const std::string &, int, int);
+    bool LoadFromSurface(SDL_Renderer *, SDL_Surface *);
+    bool CreateTarget(SDL_Renderer *, int, int);
+    bool SetAsTarget(SDL_Renderer *);
 
     void Render(SDL_Renderer *, const SDL_Rect *src = NULL, const SDL_Rect *dest = NULL);
     void Render(SDL_Renderer *, int, int, const SDL_Rect *src = NULL);
+    void SetColor(const SDL_Color &);
     void Free();
 
     int GetWidth();
     int GetHeight();
+    bool IsLoaded();
+
+    //Number of copies issued by Render since the last reset, for frame statistics
+    static Uint32 draw_calls;
 
 private:
     SDL_Texture *m_texture;
@@ -30,6 +37,8 @@ private:
     int m_height;
 };
 
+Uint32 Texture::draw_calls = 0;
+
 /**
  * Default Constructor. Initialisation via list.
  */
@@ -43,62 +52,130 @@ Texture::~Texture() {
 }
 
 /**
- * Loads texture from rendered text
- * @param g_font font of text
+ * Loads image file made of square tiles and shrinks each tile once with a box filter, so rendering
+ * tiles at their final size copies only the pixels shown. White pixels are made transparent.
  * @param g_renderer used for rendering
- * @param text text to be shown
- * @param text_color pointer to color of text
- * @param bg_color pointer to color of background. If empty or NULL, solid rendering is used, else shaded rendering is used.
+ * @param path location of image file
+ * @param tile side of each tile in the image
+ * @param size side of each tile in the texture, at most tile
  * @return true on success, false otherwise
  */
-bool Texture::LoadFromRenderedText(TTF_Font *g_font, SDL_Renderer *g_renderer, const std::string &text, const SDL_Color *text_color, const SDL_Color *bg_color) {
+bool Texture::LoadScaledTiles(SDL_Renderer *g_renderer, const std::string &path, int tile, int size) {
     Free();
-    SDL_Surface *temp_surface = NULL;
-    if (bg_color == NULL) {
-        temp_surface = TTF_RenderText_Solid(g_font, text.c_str(), *text_color);
-    } else {
-        temp_surface = TTF_RenderText_Shaded(g_font, text.c_str(), *text_color, *bg_color);
+    SDL_Surface *loaded = IMG_Load(path.c_str());
+    if (loaded == NULL) {
+        printf("Unable to load image %s! IMG Error: %s\n", path.c_str(), IMG_GetError());
+        return false;
+    }
+    SDL_Surface *src = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (src == NULL) {
+        printf("Unable to convert image %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+        return false;
     }
-    if (temp_surface == NULL) {
-        printf("Unable to render text surface! TTF Error: %s\n", TTF_GetError());
+    const int cols = src->w / tile;
+    const int rows = src->h / tile;
+    SDL_Surface *dst = SDL_CreateRGBSurfaceWithFormat(0, cols * size, rows * size, 32, SDL_PIXELFORMAT_RGBA32);
+    if (dst == NULL) {
+        printf("Unable to create scaled surface! SDL Error: %s\n", SDL_GetError());
+        SDL_FreeSurface(src);
         return false;
     }
-    m_texture = SDL_CreateTextureFromSurface(g_renderer, temp_surface);
+    //Each destination pixel averages the source area it covers, weighted by overlap. Colours are
+    //premultiplied by alpha so transparent white does not bleed into tile edges.
+    const double scale = (double)tile / size;
+    for (int y = 0; y < dst->h; y++) {
+        const int tile_y = y / size * tile;
+        const double y0 = tile_y + (y % size) * scale;
+        const double y1 = y0 + scale;
+        for (int x = 0; x < dst->w; x++) {
+            const int tile_x = x / size * tile;
+            const double x0 = tile_x + (x % size) * scale;
+            const double x1 = x0 + scale;
+            double sum[4] = {0, 0, 0, 0};
+            for (int sy = (int)y0; sy < y1 && sy < tile_y + tile; sy++) {
+                const double wy = std::min(y1, sy + 1.0) - std::max(y0, (double)sy);
+                const Uint8 *row = (const Uint8 *)src->pixels + sy * src->pitch;
+                for (int sx = (int)x0; sx < x1 && sx < tile_x + tile; sx++) {
+                    const double w = wy * (std::min(x1, sx + 1.0) - std::max(x0, (double)sx));
+                    const Uint8 *p = row + sx * 4;
+                    //Colour key white to transparent
+                    const double a = (p[0] == 0xff && p[1] == 0xff && p[2] == 0xff) ? 0 : p[3] * w;
+                    sum[0] += p[0] * a;
+                    sum[1] += p[1] * a;
+                    sum[2] += p[2] * a;
+                    sum[3] += a;
+                }
+            }
+            Uint8 *q = (Uint8 *)dst->pixels + y * dst->pitch + x * 4;
+            for (int c = 0; c < 3; c++) {
+                q[c] = sum[3] > 0 ? (Uint8)(sum[c] / sum[3] + 0.5) : 0;
+            }
+            q[3] = (Uint8)(sum[3] / (scale * scale) + 0.5);
+        }
+    }
+    SDL_FreeSurface(src);
+    m_texture = SDL_CreateTextureFromSurface(g_renderer, dst);
     if (m_texture == NULL) {
-        printf("Unable to create texture from text! SDL Error: %s\n", SDL_GetError());
+        printf("Unable to create texture from scaled image! SDL Error: %s\n", SDL_GetError());
+        SDL_FreeSurface(dst);
         return false;
     }
-    m_width = temp_surface->w;
-    m_height = temp_surface->h;
-    SDL_FreeSurface(temp_surface);
+    SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+    m_width = dst->w;
+    m_height = dst->h;
+    SDL_FreeSurface(dst);
     return true;
 }
 
 /**
- * Loads texture from image file
+ * Loads texture from a surface, which stays owned by the caller
  * @param g_renderer used for rendering
- * @param path location of image file
+ * @param surface pixels to be uploaded
  * @return true on success, false otherwise
  */
-bool Texture::LoadFromFile(SDL_Renderer *g_renderer, const std::string &path) {
+bool Texture::LoadFromSurface(SDL_Renderer *g_renderer, SDL_Surface *surface) {
     Free();
-    SDL_Surface *tempSurface = IMG_Load(path.c_str());
-    if (tempSurface == NULL) {
-        printf("Unable to load image %s! IMG Error: %s\n", path.c_str(), IMG_GetError());
+    m_texture = SDL_CreateTextureFromSurface(g_renderer, surface);
+    if (m_texture == NULL) {
+        printf("Unable to create texture from surface! SDL Error: %s\n", SDL_GetError());
         return false;
     }
-    SDL_SetColorKey(tempSurface, SDL_TRUE, SDL_MapRGB(tempSurface->format, 0xff, 0xff, 0xff));
-    m_texture = SDL_CreateTextureFromSurface(g_renderer, tempSurface);
+    SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+    m_width = surface->w;
+    m_height = surface->h;
+    return true;
+}
+
+/**
+ * Creates a blank texture that can be rendered to, see SetAsTarget
+ * @param g_renderer used for rendering
+ * @param width width of texture
+ * @param height height of texture
+ * @return true on success, false otherwise (e.g. larger than the renderer's maximum texture size)
+ */
+bool Texture::CreateTarget(SDL_Renderer *g_renderer, int width, int height) {
+    Free();
+    m_texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
     if (m_texture == NULL) {
-        printf("Unable to create texture from image! SDL Error: %s\n", SDL_GetError());
+        printf("Unable to create target texture! SDL Error: %s\n", SDL_GetError());
         return false;
     }
-    m_width = tempSurface->w;
-    m_height = tempSurface->h;
-    SDL_FreeSurface(tempSurface);
+    SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+    m_width = width;
+    m_height = height;
     return true;
 }
 
+/**
+ * Directs rendering to this texture until SDL_SetRenderTarget(g_renderer, NULL)
+ * @param g_renderer renderer to be redirected
+ * @return true on success, false otherwise
+ */
+bool Texture::SetAsTarget(SDL_Renderer *g_renderer) {
+    return SDL_SetRenderTarget(g_renderer, m_texture) == 0;
+}
+
 /**
  * Renders this texture to the destination
  * @param g_renderer renderer to be loaded to
@@ -106,6 +183,7 @@ bool Texture::LoadFromFile(SDL_Renderer *g_renderer, const std::string &path) {
  * @param dest location to render texture to. If empty or NULL, full rendering target is used.
  */
 void Texture::Render(SDL_Renderer *g_renderer, const SDL_Rect *src, const SDL_Rect *dest) {
+    draw_calls++;
     SDL_RenderCopy(g_renderer, m_texture, src, dest);
 }
 
@@ -118,16 +196,28 @@ void Texture::Render(SDL_Renderer *g_renderer, const SDL_Rect *src, const SDL_Re
  */
 void Texture::Render(SDL_Renderer *g_renderer, int x, int y, const SDL_Rect *src) {
     const SDL_Rect dest{x, y, m_width, m_height};
+    draw_calls++;
     SDL_RenderCopy(g_renderer, m_texture, src, &dest);
 }
 
+/**
+ * Tints later renders of this texture
+ * @param color multiplied with each pixel, alpha included
+ */
+void Texture::SetColor(const SDL_Color &color) {
+    SDL_SetTextureColorMod(m_texture, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(m_texture, color.a);
+}
+
 /**
  * Deallocates memory.
  */
 void Texture::Free() {
-    if (!m_texture) {
+    if (m_texture) {
         SDL_DestroyTexture(m_texture);
         m_texture = NULL;
+        m_width = 0;
+        m_height = 0;
     }
 }
 
@@ -145,4 +235,11 @@ int Texture::GetHeight() {
     return m_height;
 }
 
+/**
+ * @return true if a texture is held
+ */
+bool Texture::IsLoaded() {
+    return m_texture != NULL;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "logic.h"
+#include "replay.h"
+#include "solver.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * Headless replay verifier, built as minesweeper_verify. Plays replays again on the Board engine
+ * on all cores and checks their claimed outcome, see VerifyReplay.
+ *
+ * Usage: minesweeper_verify [--threads N] [--generate N] [--seed N] [FILE...]
+ *   --threads   number of threads, default all cores
+ *   --generate  verify N generated replays instead of files, a benchmark corpus of bot games
+ *               over the three presets and first click rules
+ *   --seed      base seed of the generated replays, default 1
+ *
+ * Exits with 1 if any replay fails to load or verify.
+ */
+
+using Clock = chrono::steady_clock;
+
+/**
+ * Records a bot game: it opens the centre, then every cell the Solver proves safe, flags every
+ * proven mine and otherwise opens a random unopened cell, 100-999 ms apart
+ * @param game index of the game, picks the preset and first click rule
+ * @param base base seed, game i is seeded with StreamSeed(base, i)
+ */
+Replay GenerateReplay(long long game, uint64_t base) {
+    Replay replay;
+    replay.seed = StreamSeed(base, game);
+    replay.first_click = (FirstClick)(game / 3 % 3);
+    Board board((Level)(game % 3), replay.seed, replay.first_click);
+    replay.height = board.GetHeight();
+    replay.width = board.GetWidth();
+    replay.mines = board.GetFlagsLeft();
+    int width = replay.width;
+    int cells = replay.height * width;
+
+    Xoshiro256 gen{replay.seed};
+    GridView view = board.GetView();
+    Solver solver{view};
+    GameState state = PLAYING;
+    uint32_t time = 0;
+    auto act = [&](ReplayAction action, int index) {
+        if (!replay.moves.empty()) {
+            time += 100 + gen() % 900;
+        }
+        replay.moves.push_back({time, action, index});
+        if (action == REPLAY_OPEN) {
+            state = board.Open(index / width, index % width);
+        } else {
+            board.Flag(index / width, index % width);
+        }
+        solver.Update(board.GetChanges());
+    };
+    act(REPLAY_OPEN, replay.height / 2 * width + width / 2);
+    size_t next_safe = 0;
+    size_t next_mine = 0;
+    while (state == PLAYING) {
+        solver.Solve();
+        const vector<int> &safe = solver.GetSafe();
+        const vector<int> &mines = solver.GetMines();
+        if (next_safe < safe.size()) {
+            int index = safe[next_safe++];
+            if (view.At(index) == 10) {
+                act(REPLAY_OPEN, index);
+            }
+        } else if (next_mine < mines.size()) {
+            act(REPLAY_FLAG, mines[next_mine++]);
+        } else {
+            int index = gen() % cells;
+            while (view.At(index) != 10) {
+                index = (index + 1) % cells;
+            }
+            act(REPLAY_OPEN, index);
+        }
+    }
+    replay.result = state;
+    replay.duration = time;
+    return replay;
+}
+
+/**
+ * Runs work(i) for every i in [0, count) on threads claiming blocks of indices
+ */
+template <typename F>
+void ParallelFor(long long count, int threads, F work) {
+    atomic<long long> next{0};
+    const long long block = 64;
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            for (long long begin = next.fetch_add(block); begin < count; begin = next.fetch_add(block)) {
+                for (long long i = begin; i < min(begin + block, count); i++) {
+                    work(i);
+                }
+            }
+        });
+    }
+    for (thread &worker : workers) {
+        worker.join();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int threads = max(1u, thread::hardware_concurrency());
+    long long generate = 0;
+    uint64_t seed = 1;
+    vector<string> paths;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 < argc && arg == "--threads") {
+            threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && arg == "--generate") {
+            generate = atoll(argv[++i]);
+        } else if (i + 1 < argc && arg == "--seed") {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            fprintf(stderr, "Usage: %s [--threads N] [--generate N] [--seed N] [FILE...]\n", argv[0]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (threads < 1 || (generate < 1 && paths.empty())) {
+        fprintf(stderr, "Nothing to verify, give replay files or --generate N with at least 1 thread\n");
+        return 2;
+    }
+
+    //The corpus is encoded up front, so the timed part decodes and verifies as for files
+    vector<uint8_t> corpus;
+    vector<size_t> offsets;
+    int failures = 0;
+    if (generate > 0) {
+        vector<vector<uint8_t>> encoded(generate);
+        ParallelFor(generate, threads, [&](long long i) {
+            EncodeReplay(GenerateReplay(i, seed), encoded[i]);
+        });
+        for (const vector<uint8_t> &replay : encoded) {
+            offsets.push_back(corpus.size());
+            corpus.insert(corpus.end(), replay.begin(), replay.end());
+        }
+    }
+    for (const string &path : paths) {
+        Replay replay;
+        if (!LoadReplay(path, replay)) {
+            fprintf(stderr, "%s: not a replay\n", path.c_str());
+            failures += 1;
+            continue;
+        }
+        offsets.push_back(corpus.size());
+        EncodeReplay(replay, corpus);
+    }
+    offsets.push_back(corpus.size());
+
+    long long count = offsets.size() - 1;
+    vector<uint8_t> valid(count, 0);
+    atomic<long long> moves{0};
+    auto start = Clock::now();
+    ParallelFor(count, threads, [&](long long i) {
+        Replay replay;
+        size_t size = offsets[i + 1] - offsets[i];
+        if (DecodeReplay(&corpus[offsets[i]], size, replay) == size) {
+            valid[i] = VerifyReplay(replay);
+            moves += replay.moves.size();
+        }
+    });
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    long long verified = 0;
+    for (long long i = 0; i < count; i++) {
+        verified += valid[i];
+        if (!valid[i] && i >= generate) {
+            fprintf(stderr, "%s: does not verify\n", paths[i - generate].c_str());
+        }
+    }
+    failures += count - verified;
+    printf("%lld of %lld replays verified, %lld moves, %.1f bytes per move\n", verified, count, moves.load(),
+           (double)corpus.size() / max(1LL, moves.load()));
+    printf("threads %d  time %.3f s  %.0f replays/s  %.0f moves/s\n", threads, seconds, count / seconds, moves / seconds);
+    return failures ? 1 : 0;
+}